@@ -0,0 +1,723 @@
+// Insert and lookup throughput of every filter in this library side by side.
+//
+//   filter_bench [--keys N[,N...]] [--threads T[,T...]] [--fpp P]
+//                [--filters NAME[,NAME...]] [--csv PATH] [--json PATH]
+//
+// Key counts take k, M and G suffixes (powers of 1000) and default to 10M;
+// thread counts default to 1 and the number of online CPUs. --filters picks
+// rows by name, where a name also selects its variants (sbbf runs sbbf/u64 and
+// the rest). Results go to stdout and, for regression tracking, to a CSV file
+// with a header row or a JSON array of one object per row.
+//
+// Keys are distinct 64-bit integers. Every inserted key is looked up (hits),
+// then a sample of up to BENCH_MAX_NEGATIVES keys that were never inserted
+// (misses), which gives the measured FPP. Memory use is 8 bytes per key plus
+// the sample and the filter. Lookups always run on the given number of threads;
+// inserts do when the backend has a concurrent insert or a parallel build, and
+// otherwise run on one thread, which the insert threads column shows.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "bloomfilter.h"
+#include "sbbf.h"
+#include "bbf.h"
+#include "gbf.h"
+#include "cbf.h"
+#include "static_filter.h"
+#include "binary_fuse.h"
+#include "ribbon.h"
+#include "vqf.h"
+#include "swf.h"
+#include "parallel_build.h"
+
+#define BENCH_MAX_NEGATIVES ((size_t)1 << 26)
+#define BENCH_MAX_RUNS 16
+// Keys per lookup call; the result bitmap stays on the stack
+#define BENCH_CHUNK 4096
+
+typedef struct Backend {
+    const char* name;
+    // Sizing hint handed to create, as a fraction of the real key count
+    double ndv_scale;
+    // FPP to build for instead of the one on the command line, 0 for none
+    double fixed_fpp;
+    void* (*Create)(long int ndv, double fpp);
+    // Inserts n keys with up to threads threads and returns how many it used,
+    // or 0 when the filter could not take them all
+    int (*Insert)(void* filter, const uint64_t* keys, size_t n, int threads);
+    // Sets bit i of result when key i may be present. Called from several
+    // threads at once once the keys are in.
+    void (*Find)(void* filter, const uint64_t* keys, size_t n, uint64_t* result);
+    uint64_t (*Bytes)(void* filter);
+    void (*Destroy)(void* filter);
+} Backend;
+
+//-----------------------------------------------------------------------------
+// Classic Bloom filter
+
+static void* classicCreate(long int ndv, double fpp){
+    return createBloomFilter(ndv, fpp);
+}
+
+static int classicInsert(void* filter, const uint64_t* keys, size_t n, int threads){
+    BloomFilterBuildFromKeys((BloomFilter*)filter, keys, sizeof(uint64_t), n, threads);
+    return threads;
+}
+
+static void classicFind(void* filter, const uint64_t* keys, size_t n, uint64_t* result){
+    memset(result, 0, (n + 63) / 64 * sizeof(uint64_t));
+    for(size_t i = 0; i < n; i++){
+        result[i / 64] |= (uint64_t)(Check((BloomFilter*)filter, &keys[i], sizeof(uint64_t)) == 0) << (i % 64);
+    }
+}
+
+static uint64_t classicBytes(void* filter){
+    return ((BloomFilter*)filter)->num_words * sizeof(uint64_t);
+}
+
+static void classicDestroy(void* filter){
+    free(((BloomFilter*)filter)->bit_array);
+    free(filter);
+}
+
+//-----------------------------------------------------------------------------
+// Split block filter, sized up front. Several threads build it with the
+// partitioned bulk build, or for integer keys with concurrent inserts.
+
+static void* sbbfCreate(long int ndv, double fpp){
+    return createSplitBlockBloomFilter(ndv, fpp);
+}
+
+static int sbbfInsert(void* filter, const uint64_t* keys, size_t n, int threads){
+    SplitBlockBloomFilter* bf = (SplitBlockBloomFilter*)filter;
+    if(threads > 1){
+        SbbfBuildFromKeys(bf, keys, sizeof(uint64_t), n, threads);
+    }else{
+        InsertBatch(bf, keys, sizeof(uint64_t), n);
+    }
+    return threads;
+}
+
+static void sbbfFind(void* filter, const uint64_t* keys, size_t n, uint64_t* result){
+    CheckKeyBatch((SplitBlockBloomFilter*)filter, keys, sizeof(uint64_t), n, result);
+}
+
+typedef struct {
+    SplitBlockBloomFilter* bf;
+    const uint64_t* keys;
+} SbbfInsertJob;
+
+static void sbbfInsertU64Body(void* ctx, size_t begin, size_t end){
+    SbbfInsertJob* job = (SbbfInsertJob*)ctx;
+    InsertU64Batch(job->bf, job->keys + begin, end - begin);
+}
+
+static int sbbfInsertU64(void* filter, const uint64_t* keys, size_t n, int threads){
+    SbbfInsertJob job = {(SplitBlockBloomFilter*)filter, keys};
+    if(threads > 1){
+        EnableConcurrentInserts(job.bf);
+    }
+    ParallelFor(n, threads, sbbfInsertU64Body, &job);
+    return threads;
+}
+
+static void sbbfFindU64(void* filter, const uint64_t* keys, size_t n, uint64_t* result){
+    CheckKeyU64Batch((SplitBlockBloomFilter*)filter, keys, n, result);
+}
+
+static uint64_t sbbfBytes(void* filter){
+    return ((SplitBlockBloomFilter*)filter)->size / 8;
+}
+
+static void sbbfDestroy(void* filter){
+    DestroySplitBlockBloomFilter((SplitBlockBloomFilter*)filter);
+}
+
+//-----------------------------------------------------------------------------
+// Blocked Bloom filter
+
+static void* blockedCreate(long int ndv, double fpp){
+    return createBlockedBloomFilter(ndv, fpp);
+}
+
+static int blockedInsert(void* filter, const uint64_t* keys, size_t n, int threads){
+    for(size_t i = 0; i < n; i++){
+        BlockedPut((BlockedBloomFilter*)filter, &keys[i], sizeof(uint64_t));
+    }
+    return 1;
+}
+
+static void blockedFind(void* filter, const uint64_t* keys, size_t n, uint64_t* result){
+    memset(result, 0, (n + 63) / 64 * sizeof(uint64_t));
+    for(size_t i = 0; i < n; i++){
+        result[i / 64] |= (uint64_t)(BlockedCheck((BlockedBloomFilter*)filter, &keys[i], sizeof(uint64_t)) == 0) << (i % 64);
+    }
+}
+
+static uint64_t blockedBytes(void* filter){
+    return ((BlockedBloomFilter*)filter)->size / 8;
+}
+
+static void blockedDestroy(void* filter){
+    free(((BlockedBloomFilter*)filter)->bit_array);
+    free(filter);
+}
+
+//-----------------------------------------------------------------------------
+// Growable split block filter
+
+static void* gbfCreate(long int ndv, double fpp){
+    return createGrowableBloomFilter(ndv, fpp);
+}
+
+static int gbfInsert(void* filter, const uint64_t* keys, size_t n, int threads){
+    GrowableInsertBatch((GrowableBloomFilter*)filter, keys, sizeof(uint64_t), n);
+    return 1;
+}
+
+static void gbfFind(void* filter, const uint64_t* keys, size_t n, uint64_t* result){
+    GrowableCheckKeyBatch((GrowableBloomFilter*)filter, keys, sizeof(uint64_t), n, result);
+}
+
+static int gbfInsertU64(void* filter, const uint64_t* keys, size_t n, int threads){
+    GrowableInsertU64Batch((GrowableBloomFilter*)filter, keys, n);
+    return 1;
+}
+
+static void gbfFindU64(void* filter, const uint64_t* keys, size_t n, uint64_t* result){
+    GrowableCheckKeyU64Batch((GrowableBloomFilter*)filter, keys, n, result);
+}
+
+static uint64_t gbfBytes(void* filter){
+    return GrowableSizeInBytes((GrowableBloomFilter*)filter);
+}
+
+static void gbfDestroy(void* filter){
+    DestroyGrowableBloomFilter((GrowableBloomFilter*)filter);
+}
+
+//-----------------------------------------------------------------------------
+// Blocked counting filter, which can delete
+
+static void* cbfCreate(long int ndv, double fpp){
+    return createCountingBloomFilter(ndv, fpp);
+}
+
+static int cbfInsert(void* filter, const uint64_t* keys, size_t n, int threads){
+    CountingPutBatch((CountingBloomFilter*)filter, keys, sizeof(uint64_t), n);
+    return 1;
+}
+
+static void cbfFind(void* filter, const uint64_t* keys, size_t n, uint64_t* result){
+    CountingCheckBatch((CountingBloomFilter*)filter, keys, sizeof(uint64_t), n, result);
+}
+
+static uint64_t cbfBytes(void* filter){
+    return ((CountingBloomFilter*)filter)->size / 2;
+}
+
+static void cbfDestroy(void* filter){
+    DestroyCountingBloomFilter((CountingBloomFilter*)filter);
+}
+
+//-----------------------------------------------------------------------------
+// Sliding window of split block filters. The keys are spread over all slices
+// of the window, so every one of them is still in it when looked up.
+
+#define BENCH_SLICES 4
+
+static void* swfCreate(long int ndv, double fpp){
+    return createSlidingWindowFilter((ndv + BENCH_SLICES - 1) / BENCH_SLICES, fpp, BENCH_SLICES);
+}
+
+static int swfInsert(void* filter, const uint64_t* keys, size_t n, int threads){
+    SlidingWindowFilter* bf = (SlidingWindowFilter*)filter;
+    for(int i = 0; i < BENCH_SLICES; i++){
+        if(i > 0){
+            SlidingAdvance(bf);
+        }
+        size_t begin = n * i / BENCH_SLICES, end = n * (i + 1) / BENCH_SLICES;
+        SlidingInsertBatch(bf, keys + begin, sizeof(uint64_t), end - begin);
+    }
+    return 1;
+}
+
+static void swfFind(void* filter, const uint64_t* keys, size_t n, uint64_t* result){
+    SlidingCheckKeyBatch((SlidingWindowFilter*)filter, keys, sizeof(uint64_t), n, result);
+}
+
+static uint64_t swfBytes(void* filter){
+    return SlidingSizeInBytes((SlidingWindowFilter*)filter);
+}
+
+static void swfDestroy(void* filter){
+    DestroySlidingWindowFilter((SlidingWindowFilter*)filter);
+}
+
+//-----------------------------------------------------------------------------
+// Vector quotient filter, which can delete and grows by doubling; the FPP is
+// fixed by its fingerprint size
+
+static void* vqfCreate(long int ndv, double fpp){
+    return createVectorQuotientFilter(ndv);
+}
+
+static int vqfInsert(void* filter, const uint64_t* keys, size_t n, int threads){
+    return VqfPutBatch((VectorQuotientFilter*)filter, keys, sizeof(uint64_t), n) == n;
+}
+
+static void vqfFind(void* filter, const uint64_t* keys, size_t n, uint64_t* result){
+    VqfCheckBatch((VectorQuotientFilter*)filter, keys, sizeof(uint64_t), n, result);
+}
+
+static uint64_t vqfBytes(void* filter){
+    return VqfSizeInBytes((VectorQuotientFilter*)filter);
+}
+
+static void vqfDestroy(void* filter){
+    DestroyVectorQuotientFilter((VectorQuotientFilter*)filter);
+}
+
+//-----------------------------------------------------------------------------
+// Static filter, built from all keys at once; the FPP is always 1/256
+
+typedef struct {
+    StaticFilter* sf;
+} StaticHolder;
+
+static void* staticCreate(long int ndv, double fpp){
+    return calloc(1, sizeof(StaticHolder));
+}
+
+static int staticInsert(void* filter, const uint64_t* keys, size_t n, int threads){
+    StaticHolder* holder = (StaticHolder*)filter;
+    holder->sf = BuildStaticFilterFromKeys(keys, sizeof(uint64_t), n, threads);
+    return holder->sf == NULL ? 0 : threads;
+}
+
+static void staticFind(void* filter, const uint64_t* keys, size_t n, uint64_t* result){
+    StaticCheckKeyBatch(((StaticHolder*)filter)->sf, keys, sizeof(uint64_t), n, result);
+}
+
+static uint64_t staticBytes(void* filter){
+    return StaticSizeInBytes(((StaticHolder*)filter)->sf);
+}
+
+static void staticDestroy(void* filter){
+    StaticHolder* holder = (StaticHolder*)filter;
+    if(holder->sf != NULL){
+        DestroyStaticFilter(holder->sf);
+    }
+    free(holder);
+}
+
+//-----------------------------------------------------------------------------
+// Binary fuse filters, built from all keys at once like static
+
+typedef struct {
+    int fingerprint_bits;
+    BinaryFuseFilter* ff;
+} FuseHolder;
+
+static void* fuseCreate(int fingerprint_bits){
+    FuseHolder* holder = (FuseHolder*)calloc(1, sizeof(FuseHolder));
+    if(holder != NULL){
+        holder->fingerprint_bits = fingerprint_bits;
+    }
+    return holder;
+}
+
+static void* fuse8Create(long int ndv, double fpp){
+    return fuseCreate(8);
+}
+
+static void* fuse16Create(long int ndv, double fpp){
+    return fuseCreate(16);
+}
+
+static int fuseInsert(void* filter, const uint64_t* keys, size_t n, int threads){
+    FuseHolder* holder = (FuseHolder*)filter;
+    holder->ff = BuildBinaryFuseFilterFromKeys(keys, sizeof(uint64_t), n, holder->fingerprint_bits, threads);
+    return holder->ff == NULL ? 0 : threads;
+}
+
+static void fuseFind(void* filter, const uint64_t* keys, size_t n, uint64_t* result){
+    FuseCheckKeyBatch(((FuseHolder*)filter)->ff, keys, sizeof(uint64_t), n, result);
+}
+
+static uint64_t fuseBytes(void* filter){
+    return FuseSizeInBytes(((FuseHolder*)filter)->ff);
+}
+
+static void fuseDestroy(void* filter){
+    FuseHolder* holder = (FuseHolder*)filter;
+    if(holder->ff != NULL){
+        DestroyBinaryFuseFilter(holder->ff);
+    }
+    free(holder);
+}
+
+//-----------------------------------------------------------------------------
+// Ribbon filter, built from all keys at once and sized for the requested FPP
+
+typedef struct {
+    double fpp;
+    RibbonFilter* rf;
+} RibbonHolder;
+
+static void* ribbonCreate(long int ndv, double fpp){
+    RibbonHolder* holder = (RibbonHolder*)calloc(1, sizeof(RibbonHolder));
+    if(holder != NULL){
+        holder->fpp = fpp;
+    }
+    return holder;
+}
+
+static int ribbonInsert(void* filter, const uint64_t* keys, size_t n, int threads){
+    RibbonHolder* holder = (RibbonHolder*)filter;
+    holder->rf = BuildRibbonFilterFromKeys(keys, sizeof(uint64_t), n, RibbonBitsPerKey(n, holder->fpp), threads);
+    return holder->rf == NULL ? 0 : threads;
+}
+
+static void ribbonFind(void* filter, const uint64_t* keys, size_t n, uint64_t* result){
+    RibbonCheckKeyBatch(((RibbonHolder*)filter)->rf, keys, sizeof(uint64_t), n, result);
+}
+
+static uint64_t ribbonBytes(void* filter){
+    return RibbonSizeInBytes(((RibbonHolder*)filter)->rf);
+}
+
+static void ribbonDestroy(void* filter){
+    RibbonHolder* holder = (RibbonHolder*)filter;
+    if(holder->rf != NULL){
+        DestroyRibbonFilter(holder->rf);
+    }
+    free(holder);
+}
+
+//-----------------------------------------------------------------------------
+
+static const Backend backends[] = {
+    {"classic", 1, 0, classicCreate, classicInsert, classicFind, classicBytes, classicDestroy},
+    {"sbbf", 1, 0, sbbfCreate, sbbfInsert, sbbfFind, sbbfBytes, sbbfDestroy},
+    {"sbbf/u64", 1, 0, sbbfCreate, sbbfInsertU64, sbbfFindU64, sbbfBytes, sbbfDestroy},
+    {"sbbf/undersized", 1.0 / 1024, 0, sbbfCreate, sbbfInsert, sbbfFind, sbbfBytes, sbbfDestroy},
+    {"blocked", 1, 0, blockedCreate, blockedInsert, blockedFind, blockedBytes, blockedDestroy},
+    {"ribbon", 1, 0, ribbonCreate, ribbonInsert, ribbonFind, ribbonBytes, ribbonDestroy},
+    {"growable", 1, 0, gbfCreate, gbfInsert, gbfFind, gbfBytes, gbfDestroy},
+    {"growable/u64", 1, 0, gbfCreate, gbfInsertU64, gbfFindU64, gbfBytes, gbfDestroy},
+    {"growable/undersized", 1.0 / 1024, 0, gbfCreate, gbfInsert, gbfFind, gbfBytes, gbfDestroy},
+    {"counting", 1, 0, cbfCreate, cbfInsert, cbfFind, cbfBytes, cbfDestroy},
+    {"sliding/4 slices", 1, 0, swfCreate, swfInsert, swfFind, swfBytes, swfDestroy},
+    {"vqf", 1, 0, vqfCreate, vqfInsert, vqfFind, vqfBytes, vqfDestroy},
+    {"vqf/undersized", 1.0 / 1024, 0, vqfCreate, vqfInsert, vqfFind, vqfBytes, vqfDestroy},
+    // The static filter next to a split block filter of the same FPP
+    {"static", 1, 1.0 / 256, staticCreate, staticInsert, staticFind, staticBytes, staticDestroy},
+    {"fuse8", 1, 1.0 / 256, fuse8Create, fuseInsert, fuseFind, fuseBytes, fuseDestroy},
+    {"ribbon/fpp=1/256", 1, 1.0 / 256, ribbonCreate, ribbonInsert, ribbonFind, ribbonBytes, ribbonDestroy},
+    {"sbbf/fpp=1/256", 1, 1.0 / 256, sbbfCreate, sbbfInsert, sbbfFind, sbbfBytes, sbbfDestroy},
+    {"fuse16", 1, 1.0 / 65536, fuse16Create, fuseInsert, fuseFind, fuseBytes, fuseDestroy},
+    {"ribbon/fpp=1/65536", 1, 1.0 / 65536, ribbonCreate, ribbonInsert, ribbonFind, ribbonBytes, ribbonDestroy},
+    {"sbbf/fpp=1/65536", 1, 1.0 / 65536, sbbfCreate, sbbfInsert, sbbfFind, sbbfBytes, sbbfDestroy},
+};
+
+//-----------------------------------------------------------------------------
+
+typedef struct Result {
+    const char* filter;
+    size_t keys;
+    int threads;
+    int insert_threads;
+    uint64_t bytes;
+    double bits_per_key;
+    double insert_mops;        // Millions of keys per second over all threads
+    double hit_mops;
+    double miss_mops;
+    double fpp;
+    double target_fpp;
+    size_t false_negatives;
+} Result;
+
+static double now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// splitmix64 of i, so keys are distinct, spread over the whole 64-bit range and
+// can be generated in any order
+static uint64_t keyAt(uint64_t i){
+    uint64_t z = (i + 1) * 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+typedef struct {
+    uint64_t* keys;
+    uint64_t first;
+} KeyJob;
+
+static void keyBody(void* ctx, size_t begin, size_t end){
+    KeyJob* job = (KeyJob*)ctx;
+    for(size_t i = begin; i < end; i++){
+        job->keys[i] = keyAt(job->first + i);
+    }
+}
+
+typedef struct {
+    const Backend* backend;
+    void* filter;
+    const uint64_t* keys;
+    size_t found;
+} FindJob;
+
+static void findBody(void* ctx, size_t begin, size_t end){
+    FindJob* job = (FindJob*)ctx;
+    uint64_t bits[BENCH_CHUNK / 64];
+    size_t found = 0;
+    for(size_t start = begin; start < end; start += BENCH_CHUNK){
+        size_t count = end - start < BENCH_CHUNK ? end - start : BENCH_CHUNK;
+        job->backend->Find(job->filter, job->keys + start, count, bits);
+        for(size_t i = 0; i < (count + 63) / 64; i++){
+            found += __builtin_popcountll(bits[i]);
+        }
+    }
+    __atomic_fetch_add(&job->found, found, __ATOMIC_RELAXED);
+}
+
+// Looks up n keys on threads threads; returns how many may be present and the
+// time taken in *seconds
+static size_t countFound(const Backend* backend, void* filter, const uint64_t* keys, size_t n,
+                         int threads, double* seconds){
+    FindJob job = {backend, filter, keys, 0};
+    double start = now();
+    ParallelFor(n, threads, findBody, &job);
+    *seconds = now() - start;
+    return job.found;
+}
+
+// Parses a comma separated list of counts with k, M or G suffixes. Returns the
+// number parsed, or -1 on a malformed list.
+static int parseCounts(const char* text, size_t* out, int max){
+    int count = 0;
+    while(*text != '\0' && count < max){
+        char* end;
+        double value = strtod(text, &end);
+        if(end == text){
+            return -1;
+        }
+        switch(*end){
+            case 'k': case 'K': value *= 1e3; end++; break;
+            case 'm': case 'M': value *= 1e6; end++; break;
+            case 'g': case 'G': value *= 1e9; end++; break;
+        }
+        if(value < 1 || (*end != ',' && *end != '\0')){
+            return -1;
+        }
+        out[count++] = (size_t)value;
+        text = *end == ',' ? end + 1 : end;
+    }
+    return *text == '\0' ? count : -1;
+}
+
+// A row runs when a name in the list is its name or the part before a '/'
+static int selected(const char* name, const char* list){
+    if(list == NULL){
+        return 1;
+    }
+    size_t base = strcspn(name, "/");
+    while(*list != '\0'){
+        size_t length = strcspn(list, ",");
+        if((length == strlen(name) || length == base) && strncmp(name, list, length) == 0){
+            return 1;
+        }
+        list += length + (list[length] == ',');
+    }
+    return 0;
+}
+
+static void writeCsv(FILE* file, const Result* results, size_t count){
+    fprintf(file, "filter,keys,threads,insert_threads,bytes,bits_per_key,insert_mops,"
+                  "hit_mops,miss_mops,fpp,target_fpp,false_negatives\n");
+    for(size_t i = 0; i < count; i++){
+        const Result* r = &results[i];
+        fprintf(file, "%s,%zu,%d,%d,%lu,%.4f,%.3f,%.3f,%.3f,%.8f,%.8f,%zu\n", r->filter, r->keys,
+                r->threads, r->insert_threads, (unsigned long)r->bytes, r->bits_per_key, r->insert_mops,
+                r->hit_mops, r->miss_mops, r->fpp, r->target_fpp, r->false_negatives);
+    }
+}
+
+static void writeJson(FILE* file, const Result* results, size_t count){
+    fprintf(file, "[\n");
+    for(size_t i = 0; i < count; i++){
+        const Result* r = &results[i];
+        fprintf(file, "  {\"filter\": \"%s\", \"keys\": %zu, \"threads\": %d, \"insert_threads\": %d, "
+                      "\"bytes\": %lu, \"bits_per_key\": %.4f, \"insert_mops\": %.3f, \"hit_mops\": %.3f, "
+                      "\"miss_mops\": %.3f, \"fpp\": %.8f, \"target_fpp\": %.8f, \"false_negatives\": %zu}%s\n",
+                r->filter, r->keys, r->threads, r->insert_threads, (unsigned long)r->bytes, r->bits_per_key,
+                r->insert_mops, r->hit_mops, r->miss_mops, r->fpp, r->target_fpp, r->false_negatives,
+                i + 1 < count ? "," : "");
+    }
+    fprintf(file, "]\n");
+}
+
+static int writeResults(const char* path, const Result* results, size_t count,
+                        void (*Write)(FILE* file, const Result* results, size_t count)){
+    FILE* file = fopen(path, "w");
+    if(file == NULL){
+        printf("Could not open %s for writing!\n", path);
+        return -1;
+    }
+    Write(file, results, count);
+    if(fclose(file) != 0){
+        printf("Could not write %s!\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+static void usage(void){
+    printf("usage: filter_bench [--keys N[,N...]] [--threads T[,T...]] [--fpp P]\n"
+           "                    [--filters NAME[,NAME...]] [--csv PATH] [--json PATH]\n");
+}
+
+int main(int argc, char** argv){
+    size_t key_counts[BENCH_MAX_RUNS] = {10000000};
+    int num_key_counts = 1;
+    size_t thread_counts[BENCH_MAX_RUNS] = {1};
+    int num_thread_counts = 1;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if(cpus > 1){
+        thread_counts[num_thread_counts++] = cpus;
+    }
+    double fpp = 0.01;
+    const char* filters = NULL;
+    const char* csv = NULL;
+    const char* json = NULL;
+    for(int i = 1; i < argc; i += 2){
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if(strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0){
+            usage();
+            return 0;
+        }
+        if(value == NULL){
+            usage();
+            return 1;
+        }
+        if(strcmp(argv[i], "--keys") == 0){
+            num_key_counts = parseCounts(value, key_counts, BENCH_MAX_RUNS);
+        }else if(strcmp(argv[i], "--threads") == 0){
+            num_thread_counts = parseCounts(value, thread_counts, BENCH_MAX_RUNS);
+        }else if(strcmp(argv[i], "--fpp") == 0){
+            fpp = atof(value);
+        }else if(strcmp(argv[i], "--filters") == 0){
+            filters = value;
+        }else if(strcmp(argv[i], "--csv") == 0){
+            csv = value;
+        }else if(strcmp(argv[i], "--json") == 0){
+            json = value;
+        }else{
+            usage();
+            return 1;
+        }
+        if(num_key_counts <= 0 || num_thread_counts <= 0 || !(fpp > 0 && fpp < 1)){
+            usage();
+            return 1;
+        }
+    }
+    int max_threads = 1;
+    for(int t = 0; t < num_thread_counts; t++){
+        if((int)thread_counts[t] > max_threads){
+            max_threads = (int)thread_counts[t];
+        }
+    }
+
+    size_t num_backends = sizeof(backends) / sizeof(backends[0]);
+    Result* results = (Result*)malloc(num_backends * num_key_counts * num_thread_counts * sizeof(Result));
+    if(results == NULL){
+        printf("Memory Not allocated!\n");
+        return 1;
+    }
+    size_t num_results = 0;
+
+    for(int k = 0; k < num_key_counts; k++){
+        size_t n = key_counts[k];
+        size_t misses = n < BENCH_MAX_NEGATIVES ? n : BENCH_MAX_NEGATIVES;
+        uint64_t* keys = (uint64_t*)malloc(n * sizeof(uint64_t));
+        uint64_t* absent = (uint64_t*)malloc(misses * sizeof(uint64_t));
+        if(keys == NULL || absent == NULL){
+            printf("Memory Not allocated!\n");
+            free(keys);
+            free(absent);
+            free(results);
+            return 1;
+        }
+        KeyJob job = {keys, 0};
+        ParallelFor(n, max_threads, keyBody, &job);
+        job.keys = absent;
+        job.first = n;
+        ParallelFor(misses, max_threads, keyBody, &job);
+
+        printf("keys: %zu, misses: %zu, target fpp: %f\n", n, misses, fpp);
+        printf("%-20s %7s %7s %12s %9s %13s %13s %13s %10s\n", "filter", "threads", "insert",
+               "bytes", "bits/key", "insert Mkey/s", "hit Mkey/s", "miss Mkey/s", "fpp");
+        for(size_t b = 0; b < num_backends; b++){
+            const Backend* backend = &backends[b];
+            if(!selected(backend->name, filters)){
+                continue;
+            }
+            for(int t = 0; t < num_thread_counts; t++){
+                int threads = (int)thread_counts[t];
+                long int ndv = (long int)(n * backend->ndv_scale);
+                double target = backend->fixed_fpp > 0 ? backend->fixed_fpp : fpp;
+                void* filter = backend->Create(ndv > 0 ? ndv : 1, target);
+                if(filter == NULL){
+                    continue;
+                }
+                Result* r = &results[num_results];
+                r->filter = backend->name;
+                r->keys = n;
+                r->threads = threads;
+                r->target_fpp = target;
+
+                double start = now();
+                r->insert_threads = backend->Insert(filter, keys, n, threads);
+                double insert = now() - start;
+                if(r->insert_threads == 0){
+                    // Left out of the CSV and JSON, which have no column for it
+                    printf("%-20s %7d  build failed\n", r->filter, r->threads);
+                    backend->Destroy(filter);
+                    continue;
+                }
+                num_results++;
+                double hit, miss;
+                size_t present = countFound(backend, filter, keys, n, threads, &hit);
+                size_t false_positives = countFound(backend, filter, absent, misses, threads, &miss);
+
+                r->bytes = backend->Bytes(filter);
+                r->bits_per_key = 8.0 * r->bytes / n;
+                r->insert_mops = n / insert / 1e6;
+                r->hit_mops = n / hit / 1e6;
+                r->miss_mops = misses / miss / 1e6;
+                r->fpp = false_positives / (double)misses;
+                r->false_negatives = n - present;
+                printf("%-20s %7d %7d %12lu %9.2f %13.2f %13.2f %13.2f %10.6f%s\n", r->filter, r->threads,
+                       r->insert_threads, (unsigned long)r->bytes, r->bits_per_key, r->insert_mops,
+                       r->hit_mops, r->miss_mops, r->fpp, r->false_negatives == 0 ? "" : "  FALSE NEGATIVES");
+                fflush(stdout);
+                backend->Destroy(filter);
+            }
+        }
+        free(keys);
+        free(absent);
+    }
+
+    int failed = (csv != NULL && writeResults(csv, results, num_results, writeCsv) != 0) ||
+                 (json != NULL && writeResults(json, results, num_results, writeJson) != 0);
+    free(results);
+    return failed;
+}
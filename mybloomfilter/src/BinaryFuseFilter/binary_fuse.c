@@ -0,0 +1,619 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "binary_fuse.h"
+#include "../hashing/hashing.h"
+#include "../parallel/parallel_build.h"
+
+#define FUSE_ARITY 3
+// Lookups per prefetch batch
+#define FUSE_BATCH 64
+// Entries a thread collects before reserving room for them in a shared list
+#define FUSE_LOCAL 1024
+#define FUSE_MAX_ATTEMPTS 64
+
+// MurmurHash3's 64-bit finalizer; remixing the key hash with a new seed gives
+// a fresh hypergraph without hashing the keys again
+static inline uint64_t keyHash(uint64_t hash, uint64_t seed){
+    uint64_t h = hash + seed;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// The three slots of a key: one in each of three consecutive segments, with
+// the first segment picked by a multiply-shift so there are no branches
+static inline void slotsOf(const BinaryFuseFilter* ff, uint64_t hash, uint64_t slot[FUSE_ARITY]){
+    uint64_t h0 = (uint64_t)(((unsigned __int128)hash * ff->segment_count_length) >> 64);
+    uint64_t h1 = h0 + ff->segment_length;
+    uint64_t h2 = h1 + ff->segment_length;
+    slot[0] = h0;
+    slot[1] = h1 ^ ((hash >> 18) & ff->segment_length_mask);
+    slot[2] = h2 ^ (hash & ff->segment_length_mask);
+}
+
+static inline uint64_t fingerprintOf(uint64_t hash){
+    return hash ^ (hash >> 32);
+}
+
+// Segment length and slot count from the paper's formulas for arity 3
+static void setSize(BinaryFuseFilter* ff, size_t n){
+    int64_t segment_length = n == 0 ? 4 : (int64_t)1 << (int)floor(log((double)n) / log(3.33) + 2.25);
+    if(segment_length > (1 << 18)){
+        segment_length = 1 << 18;
+    }
+    double size_factor = n <= 1 ? 0 : fmax(1.125, 0.875 + 0.25 * log(1000000.0) / log((double)n));
+    int64_t capacity = n <= 1 ? 0 : (int64_t)round(n * size_factor);
+    int64_t segment_count = (capacity + segment_length - 1) / segment_length - (FUSE_ARITY - 1);
+    if(segment_count < 1){
+        segment_count = 1;
+    }
+    ff->segment_length = segment_length;
+    ff->segment_length_mask = segment_length - 1;
+    ff->segment_count_length = segment_count * segment_length;
+    ff->array_length = (segment_count + FUSE_ARITY - 1) * segment_length;
+}
+
+static inline int findKey(const BinaryFuseFilter* ff, uint64_t hash, const uint64_t slot[FUSE_ARITY]){
+    if(ff->fingerprint_bits == 8){
+        const uint8_t* fp = (const uint8_t*)ff->fingerprints;
+        return (uint8_t)(fingerprintOf(hash) ^ fp[slot[0]] ^ fp[slot[1]] ^ fp[slot[2]]) == 0;
+    }
+    const uint16_t* fp = (const uint16_t*)ff->fingerprints;
+    return (uint16_t)(fingerprintOf(hash) ^ fp[slot[0]] ^ fp[slot[1]] ^ fp[slot[2]]) == 0;
+}
+
+//-----------------------------------------------------------------------------
+// Construction
+//
+// Peeling runs in rounds. Every slot touched by exactly one key is on the
+// frontier; in a round each thread claims the keys of its share of the
+// frontier (a key with two lone slots is claimed once through an atomic flag)
+// and then removes the claimed keys from their other slots, which puts slots
+// that drop to one key on the next frontier. Fingerprints are assigned round by
+// round in reverse. A key's lone slot was touched by no other key still in the
+// graph, so keys of the same round write disjoint slots and never read each
+// other's, and a round can be assigned in parallel too.
+
+typedef struct {
+    BinaryFuseFilter* ff;
+    const uint64_t* hashes;     // Key hashes as given
+    uint64_t* mixed;            // keyHash of each under the current seed, sorted by first slot
+    size_t n;
+    int threads;
+    uint32_t* degree;           // Keys left on each slot
+    uint64_t* xored;            // XOR of the indices of the keys left on each slot
+    uint8_t* claimed;           // Per key
+    uint64_t* frontier;
+    size_t frontier_count;
+    uint64_t* next;
+    size_t next_count;
+    uint64_t* order;            // Key indices in peel order
+    uint64_t* order_slot;       // The lone slot each was peeled through
+    size_t order_count;
+    size_t* histogram;          // SORT_BUCKETS counters per thread
+    size_t* rounds;             // rounds[r]: first entry of round r in order
+    size_t num_rounds;
+} PeelState;
+
+typedef struct {
+    uint64_t a[FUSE_LOCAL];
+    uint64_t b[FUSE_LOCAL];
+    size_t count;
+} LocalList;
+
+static void flush(LocalList* l, uint64_t* a, uint64_t* b, size_t* shared_count){
+    if(l->count == 0){
+        return;
+    }
+    size_t at = __atomic_fetch_add(shared_count, l->count, __ATOMIC_RELAXED);
+    memcpy(a + at, l->a, l->count * sizeof(uint64_t));
+    if(b != NULL){
+        memcpy(b + at, l->b, l->count * sizeof(uint64_t));
+    }
+    l->count = 0;
+}
+
+static inline void push(LocalList* l, uint64_t a, uint64_t b, uint64_t* shared_a, uint64_t* shared_b, size_t* shared_count){
+    if(l->count == FUSE_LOCAL){
+        flush(l, shared_a, shared_b, shared_count);
+    }
+    l->a[l->count] = a;
+    l->b[l->count++] = b;
+}
+
+// Slot updates; a single-threaded build skips the locked instructions, which
+// cost more than the rest of the peel
+static inline void addToSlot(PeelState* s, uint64_t v, uint64_t key){
+    if(s->threads > 1){
+        __atomic_fetch_add(&s->degree[v], 1, __ATOMIC_RELAXED);
+        __atomic_fetch_xor(&s->xored[v], key, __ATOMIC_RELAXED);
+    }else{
+        s->degree[v]++;
+        s->xored[v] ^= key;
+    }
+}
+
+// Returns the keys left on v
+static inline uint32_t removeFromSlot(PeelState* s, uint64_t v, uint64_t key){
+    if(s->threads > 1){
+        __atomic_fetch_xor(&s->xored[v], key, __ATOMIC_RELAXED);
+        return __atomic_sub_fetch(&s->degree[v], 1, __ATOMIC_RELAXED);
+    }
+    s->xored[v] ^= key;
+    return --s->degree[v];
+}
+
+// Returns 1 for the first caller only
+static inline int claim(PeelState* s, uint64_t key){
+    if(s->threads > 1){
+        return !__atomic_exchange_n(&s->claimed[key], 1, __ATOMIC_RELAXED);
+    }
+    int first = !s->claimed[key];
+    s->claimed[key] = 1;
+    return first;
+}
+
+static void peelWorker(void* ctx, ParallelTeam* team, int t, int threads){
+    PeelState* s = (PeelState*)ctx;
+    BinaryFuseFilter* ff = s->ff;
+    LocalList list;
+    LocalList* local = &list;
+    local->count = 0;
+    uint64_t slot[FUSE_ARITY];
+    size_t lo, hi;
+
+    // Count keys per slot
+    lo = s->n * t / threads;
+    hi = s->n * (t + 1) / threads;
+    for(size_t i = lo; i < hi; i++){
+        slotsOf(ff, s->mixed[i], slot);
+        for(int j = 0; j < FUSE_ARITY; j++){
+            addToSlot(s, slot[j], i);
+        }
+    }
+    ParallelTeamWait(team);
+
+    lo = ff->array_length * t / threads;
+    hi = ff->array_length * (t + 1) / threads;
+    for(uint64_t v = lo; v < hi; v++){
+        if(s->degree[v] == 1){
+            push(local, v, 0, s->next, NULL, &s->next_count);
+        }
+    }
+    flush(local, s->next, NULL, &s->next_count);
+    ParallelTeamWait(team);
+
+    for(;;){
+        if(t == 0){
+            uint64_t* swap = s->frontier;
+            s->frontier = s->next;
+            s->next = swap;
+            s->frontier_count = s->next_count;
+            s->next_count = 0;
+            s->rounds[s->num_rounds++] = s->order_count;
+        }
+        ParallelTeamWait(team);
+        if(s->frontier_count == 0){
+            break;
+        }
+
+        // Claim the keys on lone slots
+        lo = s->frontier_count * t / threads;
+        hi = s->frontier_count * (t + 1) / threads;
+        for(size_t i = lo; i < hi; i++){
+            uint64_t v = s->frontier[i];
+            if(s->degree[v] != 1){
+                continue;
+            }
+            uint64_t key = s->xored[v];
+            if(!claim(s, key)){
+                continue;
+            }
+            push(local, key, v, s->order, s->order_slot, &s->order_count);
+        }
+        flush(local, s->order, s->order_slot, &s->order_count);
+        ParallelTeamWait(team);
+
+        // Take them out of the graph
+        size_t start = s->rounds[s->num_rounds - 1];
+        size_t claimed = s->order_count - start;
+        lo = start + claimed * t / threads;
+        hi = start + claimed * (t + 1) / threads;
+        for(size_t k = lo; k < hi; k++){
+            uint64_t key = s->order[k];
+            slotsOf(ff, s->mixed[key], slot);
+            for(int j = 0; j < FUSE_ARITY; j++){
+                if(removeFromSlot(s, slot[j], key) == 1){
+                    push(local, slot[j], 0, s->next, NULL, &s->next_count);
+                }
+            }
+        }
+        flush(local, s->next, NULL, &s->next_count);
+        ParallelTeamWait(team);
+    }
+
+    if(s->order_count == s->n){
+        // The last round start is the end of the order
+        for(size_t r = s->num_rounds - 1; r-- > 0;){
+            size_t start = s->rounds[r], count = s->rounds[r + 1] - start;
+            lo = start + count * t / threads;
+            hi = start + count * (t + 1) / threads;
+            for(size_t k = lo; k < hi; k++){
+                uint64_t hash = s->mixed[s->order[k]];
+                uint64_t v = s->order_slot[k];
+                slotsOf(ff, hash, slot);
+                // fingerprints[v] is still zero, so XORing it in changes nothing
+                if(ff->fingerprint_bits == 8){
+                    uint8_t* fp = (uint8_t*)ff->fingerprints;
+                    fp[v] = fingerprintOf(hash) ^ fp[slot[0]] ^ fp[slot[1]] ^ fp[slot[2]];
+                }else{
+                    uint16_t* fp = (uint16_t*)ff->fingerprints;
+                    fp[v] = fingerprintOf(hash) ^ fp[slot[0]] ^ fp[slot[1]] ^ fp[slot[2]];
+                }
+            }
+            ParallelTeamWait(team);
+        }
+    }
+}
+
+// Buckets of the counting sort by first slot. Keys then reach the slot arrays
+// roughly in order, and key indices on nearby slots are close together.
+#define SORT_BUCKETS 4096
+
+static inline size_t bucketOf(uint64_t hash){
+    return (size_t)(((unsigned __int128)hash * SORT_BUCKETS) >> 64);
+}
+
+typedef struct {
+    PeelState* state;
+    uint64_t* unsorted;
+} SortJob;
+
+// Both passes run once per thread over the same slice of the keys, and each
+// thread keeps its own histogram
+static void mixAndCount(void* ctx, size_t first, size_t last){
+    SortJob* job = (SortJob*)ctx;
+    PeelState* s = job->state;
+    for(size_t t = first; t < last; t++){
+        size_t* histogram = s->histogram + t * SORT_BUCKETS;
+        memset(histogram, 0, SORT_BUCKETS * sizeof(size_t));
+        for(size_t i = s->n * t / s->threads; i < s->n * (t + 1) / s->threads; i++){
+            job->unsorted[i] = keyHash(s->hashes[i], s->ff->seed);
+            histogram[bucketOf(job->unsorted[i])]++;
+        }
+    }
+}
+
+static void scatter(void* ctx, size_t first, size_t last){
+    SortJob* job = (SortJob*)ctx;
+    PeelState* s = job->state;
+    for(size_t t = first; t < last; t++){
+        size_t* offsets = s->histogram + t * SORT_BUCKETS;
+        for(size_t i = s->n * t / s->threads; i < s->n * (t + 1) / s->threads; i++){
+            s->mixed[offsets[bucketOf(job->unsorted[i])]++] = job->unsorted[i];
+        }
+    }
+}
+
+// Mixes every hash with the current seed into s->mixed, sorted by bucket. The
+// first slot is a multiply-shift of the hash, so sorting by the top bits of
+// the hash sorts keys by first slot.
+static void mixAndSort(PeelState* s, uint64_t* unsorted){
+    SortJob job = {s, unsorted};
+    ParallelFor(s->threads, s->threads, mixAndCount, &job);
+    size_t at = 0;
+    for(size_t b = 0; b < SORT_BUCKETS; b++){
+        for(int t = 0; t < s->threads; t++){
+            size_t count = s->histogram[t * SORT_BUCKETS + b];
+            s->histogram[t * SORT_BUCKETS + b] = at;
+            at += count;
+        }
+    }
+    ParallelFor(s->threads, s->threads, scatter, &job);
+}
+
+// One attempt with the seed in ff. Returns 0 when every key peeled.
+static int peel(PeelState* s, uint64_t* unsorted){
+    BinaryFuseFilter* ff = s->ff;
+    mixAndSort(s, unsorted);
+    memset(s->degree, 0, ff->array_length * sizeof(uint32_t));
+    memset(s->xored, 0, ff->array_length * sizeof(uint64_t));
+    memset(s->claimed, 0, s->n);
+    memset(ff->fingerprints, 0, ff->array_length * ff->fingerprint_bits / 8);
+    s->frontier_count = s->next_count = s->order_count = s->num_rounds = 0;
+
+    // Later attempts keep to the threads that could be started
+    s->threads = ParallelTeamRun(s->threads, peelWorker, s);
+    return s->order_count == s->n ? 0 : -1;
+}
+
+static int compareHashes(const void* a, const void* b){
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static BinaryFuseFilter* newFilter(int fingerprint_bits){
+    if(fingerprint_bits != 8 && fingerprint_bits != 16){
+        printf("Binary fuse fingerprints are 8 or 16 bits!\n");
+        return NULL;
+    }
+    BinaryFuseFilter* ff = (BinaryFuseFilter*)malloc(sizeof(BinaryFuseFilter));
+    if(ff == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    ff->fingerprints = NULL;
+    ff->fingerprint_bits = fingerprint_bits;
+    ff->mapping = NULL;
+    ff->mapping_size = 0;
+    ff->CheckKey = FuseCheckKey;
+    return ff;
+}
+
+// Takes ownership of hashes, which may be reordered
+static BinaryFuseFilter* buildFromHashes(uint64_t* hashes, size_t n, int fingerprint_bits, int threads){
+    BinaryFuseFilter* ff = newFilter(fingerprint_bits);
+    if(ff == NULL){
+        free(hashes);
+        return NULL;
+    }
+    if(threads < 1){
+        threads = 1;
+    }
+    if((size_t)threads > n){
+        threads = n > 0 ? (int)n : 1;
+    }
+    setSize(ff, n);
+    ff->num_keys = n;
+    ff->seed = 0x726b2b9d438b9d4dULL;
+
+    PeelState s;
+    s.ff = ff;
+    s.hashes = hashes;
+    s.n = n;
+    s.threads = threads;
+    s.degree = (uint32_t*)malloc(ff->array_length * sizeof(uint32_t));
+    s.xored = (uint64_t*)malloc(ff->array_length * sizeof(uint64_t));
+    s.claimed = (uint8_t*)malloc(n + 1);
+    s.frontier = (uint64_t*)malloc(ff->array_length * sizeof(uint64_t));
+    s.next = (uint64_t*)malloc(ff->array_length * sizeof(uint64_t));
+    s.order = (uint64_t*)malloc((n + 1) * sizeof(uint64_t));
+    s.order_slot = (uint64_t*)malloc((n + 1) * sizeof(uint64_t));
+    s.rounds = (size_t*)malloc((n + 2) * sizeof(size_t));
+    s.mixed = (uint64_t*)malloc((n + 1) * sizeof(uint64_t));
+    s.histogram = (size_t*)malloc(threads * SORT_BUCKETS * sizeof(size_t));
+    uint64_t* unsorted = (uint64_t*)malloc((n + 1) * sizeof(uint64_t));
+    ff->fingerprints = aligned_alloc(64, (ff->array_length * fingerprint_bits / 8 + 63) / 64 * 64);
+    int built = 0;
+    if(s.degree == NULL || s.xored == NULL || s.claimed == NULL || s.frontier == NULL || s.next == NULL ||
+       s.order == NULL || s.order_slot == NULL || s.rounds == NULL || s.mixed == NULL ||
+       s.histogram == NULL || unsorted == NULL || ff->fingerprints == NULL){
+        printf("Memory Not allocated!\n");
+    }else{
+        for(int attempt = 0; attempt < FUSE_MAX_ATTEMPTS; attempt++){
+            if(attempt == 1){
+                // Equal hashes can never peel; they are rare enough to only
+                // look for them once a build fails
+                qsort(hashes, n, sizeof(uint64_t), compareHashes);
+                size_t unique = 0;
+                for(size_t i = 0; i < n; i++){
+                    if(unique == 0 || hashes[i] != hashes[unique - 1]){
+                        hashes[unique++] = hashes[i];
+                    }
+                }
+                s.n = ff->num_keys = n = unique;
+            }
+            if(peel(&s, unsorted) == 0){
+                built = 1;
+                break;
+            }
+            ff->seed = keyHash(ff->seed, 0x9e3779b97f4a7c15ULL);
+        }
+    }
+    free(s.degree);
+    free(s.xored);
+    free(s.claimed);
+    free(s.frontier);
+    free(s.next);
+    free(s.order);
+    free(s.order_slot);
+    free(s.rounds);
+    free(s.histogram);
+    free(unsorted);
+    free(hashes);
+    if(!built){
+        free(s.mixed);
+        free(ff->fingerprints);
+        free(ff);
+        return NULL;
+    }
+    free(s.mixed);
+    return ff;
+}
+
+typedef struct {
+    const char* keys;
+    size_t key_size;
+    uint64_t* hashes;
+} FixedKeys;
+
+static void hashFixedKeys(void* ctx, size_t begin, size_t end){
+    FixedKeys* k = (FixedKeys*)ctx;
+    HashKeys64(k->keys + begin * k->key_size, k->key_size, end - begin, FUSE_FILTER_SEED, k->hashes + begin);
+}
+
+BinaryFuseFilter* BuildBinaryFuseFilterFromKeys(const void* keys, size_t key_size, size_t n,
+                                                int fingerprint_bits, int threads){
+    uint64_t* hashes = (uint64_t*)malloc((n > 0 ? n : 1) * sizeof(uint64_t));
+    if(hashes == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    FixedKeys k = {(const char*)keys, key_size, hashes};
+    ParallelFor(n, threads, hashFixedKeys, &k);
+    return buildFromHashes(hashes, n, fingerprint_bits, threads);
+}
+
+BinaryFuseFilter* BuildBinaryFuseFilterFromHashes(const uint64_t* hashes, size_t n,
+                                                  int fingerprint_bits, int threads){
+    uint64_t* copy = (uint64_t*)malloc((n > 0 ? n : 1) * sizeof(uint64_t));
+    if(copy == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    memcpy(copy, hashes, n * sizeof(uint64_t));
+    return buildFromHashes(copy, n, fingerprint_bits, threads);
+}
+
+void DestroyBinaryFuseFilter(BinaryFuseFilter* ff){
+    if(ff->mapping != NULL){
+        munmap(ff->mapping, ff->mapping_size);
+    }else{
+        free(ff->fingerprints);
+    }
+    free(ff);
+}
+
+//-----------------------------------------------------------------------------
+// Lookup
+
+int FuseCheckKey(BinaryFuseFilter* ff, const void* str, size_t size){
+    uint64_t hash = keyHash(HashKey64(str, size, FUSE_FILTER_SEED), ff->seed);
+    uint64_t slot[FUSE_ARITY];
+    slotsOf(ff, hash, slot);
+    return !findKey(ff, hash, slot);
+}
+
+void FuseCheckKeyBatch(BinaryFuseFilter* ff, const void* keys, size_t key_size, size_t n, uint64_t* result){
+    const char* key = (const char*)keys;
+    const char* fp = (const char*)ff->fingerprints;
+    const int width = ff->fingerprint_bits / 8;
+    uint64_t hashes[FUSE_BATCH];
+    uint64_t slots[FUSE_BATCH][FUSE_ARITY];
+    for(size_t start = 0; start < n; start += FUSE_BATCH){
+        size_t count = n - start < FUSE_BATCH ? n - start : FUSE_BATCH;
+        HashKeys64(key + start * key_size, key_size, count, FUSE_FILTER_SEED, hashes);
+        for(size_t i = 0; i < count; i++){
+            hashes[i] = keyHash(hashes[i], ff->seed);
+            slotsOf(ff, hashes[i], slots[i]);
+            for(int j = 0; j < FUSE_ARITY; j++){
+                __builtin_prefetch(fp + slots[i][j] * width);
+            }
+        }
+        uint64_t found = 0;
+        for(size_t i = 0; i < count; i++){
+            found |= (uint64_t)findKey(ff, hashes[i], slots[i]) << i;
+        }
+        result[start / FUSE_BATCH] = found;
+    }
+}
+
+uint64_t FuseSizeInBytes(const BinaryFuseFilter* ff){
+    return ff->array_length * ff->fingerprint_bits / 8;
+}
+
+//-----------------------------------------------------------------------------
+// Files
+
+int SaveBinaryFuseFilter(const BinaryFuseFilter* ff, const char* path){
+    uint64_t bytes = FuseSizeInBytes(ff);
+    FuseFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FUSE_FILE_MAGIC, sizeof(header.magic));
+    header.version = FUSE_FILE_VERSION;
+    header.hash_id = FUSE_HASH_MURMUR3_X64_128_FOLDED;
+    header.hash_seed = FUSE_FILTER_SEED;
+    header.fingerprint_bits = ff->fingerprint_bits;
+    header.seed = ff->seed;
+    header.num_keys = ff->num_keys;
+    header.segment_length = ff->segment_length;
+    header.segment_count_length = ff->segment_count_length;
+    header.array_length = ff->array_length;
+    header.payload_offset = FUSE_FILE_PAYLOAD_OFFSET;
+    header.checksum = Checksum64(CHECKSUM64_BASIS, ff->fingerprints, bytes);
+
+    FILE* file = fopen(path, "wb");
+    if(file == NULL){
+        printf("Could not open %s for writing!\n", path);
+        return -1;
+    }
+    char padding[FUSE_FILE_PAYLOAD_OFFSET] = {0};
+    memcpy(padding, &header, sizeof(header));
+    int ok = fwrite(padding, 1, sizeof(padding), file) == sizeof(padding) &&
+             fwrite(ff->fingerprints, 1, bytes, file) == bytes;
+    ok = (fclose(file) == 0) && ok;
+    if(!ok){
+        printf("Could not write %s!\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+BinaryFuseFilter* OpenBinaryFuseFilter(const char* path, int verify){
+    int fd = open(path, O_RDONLY);
+    if(fd < 0){
+        printf("Could not open %s!\n", path);
+        return NULL;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (uint64_t)st.st_size < FUSE_FILE_PAYLOAD_OFFSET){
+        printf("%s is not a binary fuse filter file!\n", path);
+        close(fd);
+        return NULL;
+    }
+    void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED){
+        printf("Could not map %s!\n", path);
+        return NULL;
+    }
+
+    const FuseFileHeader* header = (const FuseFileHeader*)mapping;
+    uint64_t segment_length = header->segment_length;
+    if(memcmp(header->magic, FUSE_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+       header->version != FUSE_FILE_VERSION ||
+       header->hash_id != FUSE_HASH_MURMUR3_X64_128_FOLDED ||
+       header->hash_seed != FUSE_FILTER_SEED ||
+       (header->fingerprint_bits != 8 && header->fingerprint_bits != 16) ||
+       segment_length == 0 || (segment_length & (segment_length - 1)) != 0 ||
+       header->segment_count_length == 0 || header->segment_count_length % segment_length != 0 ||
+       header->array_length != header->segment_count_length + (FUSE_ARITY - 1) * segment_length ||
+       header->payload_offset != FUSE_FILE_PAYLOAD_OFFSET ||
+       header->payload_offset + header->array_length * header->fingerprint_bits / 8 != (uint64_t)st.st_size){
+        printf("%s is not a binary fuse filter file!\n", path);
+        munmap(mapping, st.st_size);
+        return NULL;
+    }
+    void* fingerprints = (char*)mapping + header->payload_offset;
+    if(verify && Checksum64(CHECKSUM64_BASIS, fingerprints, st.st_size - header->payload_offset) != header->checksum){
+        printf("%s failed its checksum!\n", path);
+        munmap(mapping, st.st_size);
+        return NULL;
+    }
+    madvise(fingerprints, st.st_size - header->payload_offset, MADV_RANDOM);
+
+    BinaryFuseFilter* ff = newFilter(header->fingerprint_bits);
+    if(ff == NULL){
+        munmap(mapping, st.st_size);
+        return NULL;
+    }
+    ff->fingerprints = fingerprints;
+    ff->seed = header->seed;
+    ff->segment_length = segment_length;
+    ff->segment_length_mask = segment_length - 1;
+    ff->segment_count_length = header->segment_count_length;
+    ff->array_length = header->array_length;
+    ff->num_keys = header->num_keys;
+    ff->mapping = mapping;
+    ff->mapping_size = st.st_size;
+    return ff;
+}
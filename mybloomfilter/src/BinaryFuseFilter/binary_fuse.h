@@ -0,0 +1,90 @@
+#ifndef _BINARY_FUSE_
+#define _BINARY_FUSE_
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//-----------------------------------------------------------------------------
+
+// A binary fuse filter (Graf and Lemire, 2022): an immutable filter where each
+// key's fingerprint is the XOR of three slots taken from three consecutive
+// segments of the slot array. About 1.13 slots per key are enough for large
+// sets, so 8-bit fingerprints give an FPP of 1/256 at about 9 bits per key and
+// 16-bit fingerprints 1/65536 at about 18.
+
+typedef struct BinaryFuseFilter {
+    void *fingerprints;           // array_length fingerprints of fingerprint_bits each
+    uint64_t seed;                // Remixes the key hashes; a build that fails retries with another
+    uint64_t segment_length;      // Power of two
+    uint64_t segment_length_mask;
+    uint64_t segment_count_length;// Slots the first probe can land in
+    uint64_t array_length;        // Number of slots
+    uint64_t num_keys;            // Distinct keys the filter was built from
+    int fingerprint_bits;         // 8 or 16
+    void *mapping;                // File mapping backing fingerprints, NULL when heap allocated
+    size_t mapping_size;
+    int (*CheckKey)(struct BinaryFuseFilter* ff, const void* str, size_t size);
+} BinaryFuseFilter;
+
+// Seed the builders hash keys with, for callers that hash keys themselves
+#define FUSE_FILTER_SEED 0xf05e
+
+// Builds a filter with 8- or 16-bit fingerprints from n fixed-size keys stored
+// back to back. Hashing, slot counting, peeling and fingerprint assignment all
+// run on the given number of threads. Returns NULL on error.
+BinaryFuseFilter* BuildBinaryFuseFilterFromKeys(const void* keys, size_t key_size, size_t n,
+                                                int fingerprint_bits, int threads);
+// Same, over HashKey64(key, size, FUSE_FILTER_SEED) of every key
+BinaryFuseFilter* BuildBinaryFuseFilterFromHashes(const uint64_t* hashes, size_t n,
+                                                  int fingerprint_bits, int threads);
+void DestroyBinaryFuseFilter(BinaryFuseFilter* ff);
+// Returns 0 when the key may be present and 1 when it is definitely absent
+int FuseCheckKey(BinaryFuseFilter* ff, const void* str, size_t size);
+// Sets bit i of result (n / 64 rounded up words) when key i may be present.
+// The three slots of every key in a batch are prefetched before any is read.
+void FuseCheckKeyBatch(BinaryFuseFilter* ff, const void* keys, size_t key_size, size_t n, uint64_t* result);
+uint64_t FuseSizeInBytes(const BinaryFuseFilter* ff);
+
+// On-disk format, laid out like the split block filter's: a header padded to
+// FUSE_FILE_PAYLOAD_OFFSET bytes, then the fingerprints in native byte order.
+#define FUSE_FILE_MAGIC "FUSE"
+#define FUSE_FILE_VERSION 1
+#define FUSE_FILE_PAYLOAD_OFFSET 4096
+#define FUSE_HASH_MURMUR3_X64_128_FOLDED 1  // HashKey64
+
+typedef struct FuseFileHeader {
+    char magic[4];              // FUSE_FILE_MAGIC
+    uint32_t version;           // FUSE_FILE_VERSION
+    uint32_t hash_id;           // Hash function the keys were hashed with
+    uint32_t hash_seed;         // Seed of that hash function
+    uint32_t fingerprint_bits;
+    uint32_t reserved;
+    uint64_t seed;
+    uint64_t num_keys;
+    uint64_t segment_length;
+    uint64_t segment_count_length;
+    uint64_t array_length;
+    uint64_t payload_offset;
+    uint64_t checksum;          // Checksum64 of the payload
+} FuseFileHeader;
+
+// Returns 0 on success and -1 on error
+int SaveBinaryFuseFilter(const BinaryFuseFilter* ff, const char* path);
+// Maps a saved filter read-only and serves lookups from the mapped pages.
+// When verify is non-zero the payload checksum is checked. Returns NULL on error.
+BinaryFuseFilter* OpenBinaryFuseFilter(const char* path, int verify);
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _BINARY_FUSE_
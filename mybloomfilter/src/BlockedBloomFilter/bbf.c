@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../murmur3/murmur3.h"
+#include "bbf.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+// Odd multipliers, one per probe. Probe i takes the top 9 bits of hash * seed[i],
+// which is a bit position inside the 512-bit block.
+static const uint32_t seeds[BBF_MAX_HASHES] = {
+    0x44974d91, 0x47b6137b, 0xa2b7289d, 0x8824ad5b,
+    0x2df1424b, 0x705495c7, 0x5c6bfb31, 0x9efc4947,
+    0x9e3779b1, 0x85ebca6b, 0xc2b2ae35, 0x27d4eb2f,
+    0x165667b1, 0xd3a2646d, 0xfd7046c5, 0xb55a4f09};
+
+double BlockedBloomFpp(double n, uint64_t num_blocks, int k){
+    if(n <= 0){
+        return 0;
+    }
+    // The number of keys per block is Poisson distributed; weight the FPP of a
+    // block holding j keys by the probability of that load.
+    double lambda = n / num_blocks;
+    double spread = 10 * sqrt(lambda) + 10;
+    double lo = lambda > spread ? floor(lambda - spread) : 0;
+    double hi = ceil(lambda + spread);
+    double result = 0;
+    for(double j = lo; j <= hi; j++){
+        double weight = exp(-lambda + j * log(lambda) - lgamma(j + 1));
+        double inner = pow(1 - pow(1 - 1.0 / BBF_BLOCK_BITS, j * k), k);
+        result += weight * inner;
+    }
+    return result;
+}
+
+// Picks the k that minimizes the FPP for this many blocks
+static int bestHashCount(double n, uint64_t num_blocks, double* fpp){
+    int best = 1;
+    *fpp = BlockedBloomFpp(n, num_blocks, 1);
+    for(int k = 2; k <= BBF_MAX_HASHES; k++){
+        double current = BlockedBloomFpp(n, num_blocks, k);
+        if(current < *fpp){
+            *fpp = current;
+            best = k;
+        }
+    }
+    return best;
+}
+
+BlockedBloomFilter* createBlockedBloomFilter(long int n, double p){
+    BlockedBloomFilter* bf = (BlockedBloomFilter*)malloc(sizeof(BlockedBloomFilter));
+    if(bf == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+
+    // Start from the size a classic filter would need and grow until the
+    // uneven block loads are paid for.
+    double bits = ceil((-n * log(p)) / (log(2) * log(2)));
+    uint64_t num_blocks = (uint64_t) ceil(bits / BBF_BLOCK_BITS);
+    if(num_blocks == 0){
+        num_blocks = 1;
+    }
+    double fpp;
+    int k = bestHashCount(n, num_blocks, &fpp);
+    while(fpp > p){
+        num_blocks += num_blocks / 64 + 1;
+        k = bestHashCount(n, num_blocks, &fpp);
+    }
+
+    bf->num_blocks = num_blocks;
+    bf->size = num_blocks * BBF_BLOCK_BITS;
+    bf->hash_count = k;
+    bf->bit_array = (uint64_t *) aligned_alloc(64, num_blocks * BBF_BLOCK_WORDS * sizeof(uint64_t));
+    if(bf->bit_array == NULL){
+        printf("Memory Not allocated!\n");
+        free(bf);
+        return NULL;
+    }
+    memset(bf->bit_array, 0, num_blocks * BBF_BLOCK_WORDS * sizeof(uint64_t));
+    bf->Put = BlockedPut;
+    bf->Check = BlockedCheck;
+    return bf;
+}
+
+static inline void probePositionsScalar(uint64_t hash, uint32_t pos[BBF_MAX_HASHES]){
+    for(int i = 0; i < BBF_MAX_HASHES; i++){
+        uint32_t h = (uint32_t)(i < 8 ? hash : hash >> 32);
+        pos[i] = (h * seeds[i]) >> (32 - 9);
+    }
+}
+
+#if defined(__x86_64__)
+// Compiled for AVX2 and only called when the running CPU has it
+__attribute__((target("avx2"))) static void probePositionsAvx2(uint64_t hash, uint32_t pos[BBF_MAX_HASHES]){
+    __m256i lo = _mm256_mullo_epi32(_mm256_set1_epi32((uint32_t)hash),
+                                    _mm256_loadu_si256((const __m256i*)&seeds[0]));
+    __m256i hi = _mm256_mullo_epi32(_mm256_set1_epi32((uint32_t)(hash >> 32)),
+                                    _mm256_loadu_si256((const __m256i*)&seeds[8]));
+    _mm256_storeu_si256((__m256i*)&pos[0], _mm256_srli_epi32(lo, 32 - 9));
+    _mm256_storeu_si256((__m256i*)&pos[8], _mm256_srli_epi32(hi, 32 - 9));
+}
+#endif
+
+// The low 32 bits of hash feed probes 0-7 and the high 32 bits probes 8-15
+static inline void probePositions(uint64_t hash, uint32_t pos[BBF_MAX_HASHES]){
+#if defined(__x86_64__)
+    if(__builtin_cpu_supports("avx2")){
+        probePositionsAvx2(hash, pos);
+        return;
+    }
+    probePositionsScalar(hash, pos);
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    uint32x4_t lo = vmovq_n_u32((uint32_t)hash);
+    uint32x4_t hi = vmovq_n_u32((uint32_t)(hash >> 32));
+    for(int i = 0; i < 2; i++){
+        vst1q_u32(&pos[4 * i], vshrq_n_u32(vmulq_u32(lo, vld1q_u32(&seeds[4 * i])), 32 - 9));
+        vst1q_u32(&pos[8 + 4 * i], vshrq_n_u32(vmulq_u32(hi, vld1q_u32(&seeds[8 + 4 * i])), 32 - 9));
+    }
+#else
+    probePositionsScalar(hash, pos);
+#endif
+}
+
+// Hashes the key once: the first half selects the block, the second half feeds
+// the probe positions. Returns a pointer to the block and fills mask with the
+// k bits to set or test.
+static inline uint64_t* makeMask(BlockedBloomFilter* bf, const void* str, size_t size,
+                                 uint64_t mask[BBF_BLOCK_WORDS]){
+    uint64_t hash[2];
+    MurmurHash3_x64_128(str, size, 0xb10c, hash);
+    uint64_t block = (uint64_t)(((unsigned __int128)hash[0] * bf->num_blocks) >> 64);
+
+    uint32_t pos[BBF_MAX_HASHES];
+    probePositions(hash[1], pos);
+
+    memset(mask, 0, BBF_BLOCK_WORDS * sizeof(uint64_t));
+    for(int i = 0; i < bf->hash_count; i++){
+        mask[pos[i] >> 6] |= (uint64_t)1 << (pos[i] & 63);
+    }
+    return bf->bit_array + block * BBF_BLOCK_WORDS;
+}
+
+void BlockedPut(BlockedBloomFilter* bf, const void* str, size_t size){
+    uint64_t mask[BBF_BLOCK_WORDS];
+    uint64_t* block = makeMask(bf, str, size, mask);
+    for(int i = 0; i < BBF_BLOCK_WORDS; i++){
+        block[i] |= mask[i];
+    }
+}
+
+int BlockedCheck(BlockedBloomFilter* bf, const void* str, size_t size){
+    uint64_t mask[BBF_BLOCK_WORDS];
+    uint64_t* block = makeMask(bf, str, size, mask);
+    uint64_t missing = 0;
+    for(int i = 0; i < BBF_BLOCK_WORDS; i++){
+        missing |= mask[i] & ~block[i];
+    }
+    return missing != 0;
+}
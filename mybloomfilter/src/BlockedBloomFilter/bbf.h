@@ -0,0 +1,45 @@
+#ifndef _BBF_
+#define _BBF_
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//-----------------------------------------------------------------------------
+
+// A blocked Bloom filter (Putze et al.): every key maps to a single 64-byte block
+// and all k probes land inside it, so a query costs one cache miss. Unlike the
+// split block filter, k is not fixed and is picked from the target FPP.
+
+#define BBF_BLOCK_BITS 512
+#define BBF_BLOCK_WORDS (BBF_BLOCK_BITS / 64)
+#define BBF_MAX_HASHES 16
+
+typedef struct BlockedBloomFilter {
+    uint64_t *bit_array;       // 64-byte aligned blocks of BBF_BLOCK_WORDS words
+    uint64_t num_blocks;       // Number of blocks
+    uint64_t size;             // Size of the bit array in bits (m)
+    int hash_count;             // Number of hash functions (k), at most BBF_MAX_HASHES
+    void (*Put)(struct BlockedBloomFilter* bf, const void* str, size_t size);
+    int (*Check)(struct BlockedBloomFilter* bf, const void* str, size_t size);
+} BlockedBloomFilter;
+
+BlockedBloomFilter* createBlockedBloomFilter(long int n, double p);
+void BlockedPut(BlockedBloomFilter* bf, const void* str, size_t size);
+int BlockedCheck(BlockedBloomFilter* bf, const void* str, size_t size);
+// Expected FPP of a blocked filter holding n keys in num_blocks blocks with k probes
+double BlockedBloomFpp(double n, uint64_t num_blocks, int k);
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _BBF_
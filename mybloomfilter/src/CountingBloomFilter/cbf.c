@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../hashing/hashing.h"
+#include "cbf.h"
+
+#define CBF_BATCH 64
+// Lowest bit of every 4-bit counter in a word
+#define NIBBLE_LOW 0x1111111111111111ULL
+
+// Odd multipliers, one per probe. Probe i takes the top 7 bits of hash * seed[i],
+// which is a counter inside the block.
+static const uint32_t seeds[CBF_MAX_HASHES] = {
+    0x44974d91, 0x47b6137b, 0xa2b7289d, 0x8824ad5b,
+    0x2df1424b, 0x705495c7, 0x5c6bfb31, 0x9efc4947,
+    0x9e3779b1, 0x85ebca6b, 0xc2b2ae35, 0x27d4eb2f,
+    0x165667b1, 0xd3a2646d, 0xfd7046c5, 0xb55a4f09};
+
+double CountingBloomFpp(double n, uint64_t num_blocks, int k){
+    if(n <= 0){
+        return 0;
+    }
+    // Same Poisson-weighted model as BlockedBloomFpp, over 128 counters a block
+    double lambda = n / num_blocks;
+    double spread = 10 * sqrt(lambda) + 10;
+    double lo = lambda > spread ? floor(lambda - spread) : 0;
+    double hi = ceil(lambda + spread);
+    double result = 0;
+    for(double j = lo; j <= hi; j++){
+        double weight = exp(-lambda + j * log(lambda) - lgamma(j + 1));
+        double inner = pow(1 - pow(1 - 1.0 / CBF_BLOCK_COUNTERS, j * k), k);
+        result += weight * inner;
+    }
+    return result;
+}
+
+static int bestHashCount(double n, uint64_t num_blocks, double* fpp){
+    int best = 1;
+    *fpp = CountingBloomFpp(n, num_blocks, 1);
+    for(int k = 2; k <= CBF_MAX_HASHES; k++){
+        double current = CountingBloomFpp(n, num_blocks, k);
+        if(current < *fpp){
+            *fpp = current;
+            best = k;
+        }
+    }
+    return best;
+}
+
+CountingBloomFilter* createCountingBloomFilter(long int n, double p){
+    CountingBloomFilter* bf = (CountingBloomFilter*)malloc(sizeof(CountingBloomFilter));
+    if(bf == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+
+    double counters = ceil((-n * log(p)) / (log(2) * log(2)));
+    uint64_t num_blocks = (uint64_t) ceil(counters / CBF_BLOCK_COUNTERS);
+    if(num_blocks == 0){
+        num_blocks = 1;
+    }
+    double fpp;
+    int k = bestHashCount(n, num_blocks, &fpp);
+    while(fpp > p){
+        num_blocks += num_blocks / 64 + 1;
+        k = bestHashCount(n, num_blocks, &fpp);
+    }
+
+    bf->num_blocks = num_blocks;
+    bf->size = num_blocks * CBF_BLOCK_COUNTERS;
+    bf->hash_count = k;
+    bf->seed = 0xc0c0;
+    bf->counters = (uint64_t *) aligned_alloc(64, num_blocks * CBF_BLOCK_WORDS * sizeof(uint64_t));
+    if(bf->counters == NULL){
+        printf("Memory Not allocated!\n");
+        free(bf);
+        return NULL;
+    }
+    memset(bf->counters, 0, num_blocks * CBF_BLOCK_WORDS * sizeof(uint64_t));
+    bf->Put = CountingPut;
+    bf->Delete = CountingDelete;
+    bf->Check = CountingCheck;
+    return bf;
+}
+
+void DestroyCountingBloomFilter(CountingBloomFilter* bf){
+    free(bf->counters);
+    free(bf);
+}
+
+static inline uint64_t* blockOf(const CountingBloomFilter* bf, uint64_t hash){
+    return bf->counters + (uint64_t)(((unsigned __int128)hash * bf->num_blocks) >> 64) * CBF_BLOCK_WORDS;
+}
+
+// The high bits of the hash pick the block and the low 32 bits feed the probes.
+// mask gets the lowest bit of each probed counter set; probes that collide set
+// the same bit, so such a key counts once in that counter.
+static inline void makeMask(const CountingBloomFilter* bf, uint64_t hash, uint64_t mask[CBF_BLOCK_WORDS]){
+    memset(mask, 0, CBF_BLOCK_WORDS * sizeof(uint64_t));
+    for(int i = 0; i < bf->hash_count; i++){
+        uint32_t pos = ((uint32_t)hash * seeds[i]) >> (32 - 7);
+        mask[pos >> 4] |= (uint64_t)1 << (4 * (pos & 15));
+    }
+}
+
+// Lowest bit of each counter that is non-zero, and of each that is saturated
+static inline uint64_t nonZero(uint64_t word){
+    return (word | word >> 1 | word >> 2 | word >> 3) & NIBBLE_LOW;
+}
+
+static inline uint64_t saturated(uint64_t word){
+    return word & word >> 1 & word >> 2 & word >> 3 & NIBBLE_LOW;
+}
+
+static inline int blockContains(const uint64_t* block, const uint64_t mask[CBF_BLOCK_WORDS]){
+    uint64_t missing = 0;
+    for(int i = 0; i < CBF_BLOCK_WORDS; i++){
+        missing |= mask[i] & ~nonZero(block[i]);
+    }
+    return missing == 0;
+}
+
+// Counters below 15 take +1 without carrying into their neighbour
+static inline void blockPut(uint64_t* block, const uint64_t mask[CBF_BLOCK_WORDS]){
+    for(int i = 0; i < CBF_BLOCK_WORDS; i++){
+        block[i] += mask[i] & ~saturated(block[i]);
+    }
+}
+
+// Non-zero counters take -1 without borrowing; saturated ones may hold more
+// keys than 15 and stay put
+static inline void blockDelete(uint64_t* block, const uint64_t mask[CBF_BLOCK_WORDS]){
+    for(int i = 0; i < CBF_BLOCK_WORDS; i++){
+        block[i] -= mask[i] & nonZero(block[i]) & ~saturated(block[i]);
+    }
+}
+
+void CountingPut(CountingBloomFilter* bf, const void* str, size_t size){
+    uint64_t hash = HashKey64(str, size, bf->seed);
+    uint64_t mask[CBF_BLOCK_WORDS];
+    makeMask(bf, hash, mask);
+    blockPut(blockOf(bf, hash), mask);
+}
+
+int CountingDelete(CountingBloomFilter* bf, const void* str, size_t size){
+    uint64_t hash = HashKey64(str, size, bf->seed);
+    uint64_t mask[CBF_BLOCK_WORDS];
+    makeMask(bf, hash, mask);
+    uint64_t* block = blockOf(bf, hash);
+    if(!blockContains(block, mask)){
+        return 1;
+    }
+    blockDelete(block, mask);
+    return 0;
+}
+
+int CountingCheck(CountingBloomFilter* bf, const void* str, size_t size){
+    uint64_t hash = HashKey64(str, size, bf->seed);
+    uint64_t mask[CBF_BLOCK_WORDS];
+    makeMask(bf, hash, mask);
+    return !blockContains(blockOf(bf, hash), mask);
+}
+
+// Hashes keys[start, start + count) and prefetches their blocks for writing or reading
+static inline void hashBatch(const CountingBloomFilter* bf, const char* key, size_t key_size, size_t count,
+                             uint64_t hashes[CBF_BATCH], int write){
+    HashKeys64(key, key_size, count, bf->seed, hashes);
+    for(size_t i = 0; i < count; i++){
+        if(write){
+            __builtin_prefetch(blockOf(bf, hashes[i]), 1);
+        }else{
+            __builtin_prefetch(blockOf(bf, hashes[i]), 0);
+        }
+    }
+}
+
+void CountingPutBatch(CountingBloomFilter* bf, const void* keys, size_t key_size, size_t n){
+    const char* key = (const char*)keys;
+    uint64_t hashes[CBF_BATCH];
+    uint64_t mask[CBF_BLOCK_WORDS];
+    for(size_t start = 0; start < n; start += CBF_BATCH){
+        size_t count = n - start < CBF_BATCH ? n - start : CBF_BATCH;
+        hashBatch(bf, key + start * key_size, key_size, count, hashes, 1);
+        for(size_t i = 0; i < count; i++){
+            makeMask(bf, hashes[i], mask);
+            blockPut(blockOf(bf, hashes[i]), mask);
+        }
+    }
+}
+
+void CountingDeleteBatch(CountingBloomFilter* bf, const void* keys, size_t key_size, size_t n){
+    const char* key = (const char*)keys;
+    uint64_t hashes[CBF_BATCH];
+    uint64_t mask[CBF_BLOCK_WORDS];
+    for(size_t start = 0; start < n; start += CBF_BATCH){
+        size_t count = n - start < CBF_BATCH ? n - start : CBF_BATCH;
+        hashBatch(bf, key + start * key_size, key_size, count, hashes, 1);
+        for(size_t i = 0; i < count; i++){
+            uint64_t* block = blockOf(bf, hashes[i]);
+            makeMask(bf, hashes[i], mask);
+            if(blockContains(block, mask)){
+                blockDelete(block, mask);
+            }
+        }
+    }
+}
+
+void CountingCheckBatch(CountingBloomFilter* bf, const void* keys, size_t key_size, size_t n, uint64_t* result){
+    const char* key = (const char*)keys;
+    uint64_t hashes[CBF_BATCH];
+    uint64_t mask[CBF_BLOCK_WORDS];
+    for(size_t start = 0; start < n; start += CBF_BATCH){
+        size_t count = n - start < CBF_BATCH ? n - start : CBF_BATCH;
+        hashBatch(bf, key + start * key_size, key_size, count, hashes, 0);
+        uint64_t found = 0;
+        for(size_t i = 0; i < count; i++){
+            makeMask(bf, hashes[i], mask);
+            found |= (uint64_t)blockContains(blockOf(bf, hashes[i]), mask) << i;
+        }
+        result[start / CBF_BATCH] = found;
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef _CBF_
+#define _CBF_
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//-----------------------------------------------------------------------------
+
+// A blocked counting Bloom filter: the bits of a blocked filter become 4-bit
+// counters, so keys can be deleted. Every key maps to one 64-byte block of 128
+// counters and its k probes all land inside it. Inserts and deletes update all
+// 16 counters of a word at once, and a counter that reaches 15 sticks there so
+// that overflow can never cause a false negative.
+
+#define CBF_BLOCK_COUNTERS 128
+#define CBF_BLOCK_WORDS (CBF_BLOCK_COUNTERS * 4 / 64)
+#define CBF_MAX_HASHES 16
+
+typedef struct CountingBloomFilter {
+    uint64_t *counters;        // 64-byte aligned blocks of CBF_BLOCK_WORDS words, 16 counters per word
+    uint64_t num_blocks;       // Number of blocks
+    uint64_t size;             // Number of counters
+    int hash_count;             // Number of hash functions (k), at most CBF_MAX_HASHES
+    uint32_t seed;              // Seed of the key hash
+    void (*Put)(struct CountingBloomFilter* bf, const void* str, size_t size);
+    int (*Delete)(struct CountingBloomFilter* bf, const void* str, size_t size);
+    int (*Check)(struct CountingBloomFilter* bf, const void* str, size_t size);
+} CountingBloomFilter;
+
+CountingBloomFilter* createCountingBloomFilter(long int n, double p);
+void DestroyCountingBloomFilter(CountingBloomFilter* bf);
+void CountingPut(CountingBloomFilter* bf, const void* str, size_t size);
+// Removes one earlier Put of the key. Deleting a key that was never put can
+// cause false negatives for other keys; when the filter can tell the key is
+// absent it leaves the counters alone and returns 1, otherwise it returns 0.
+int CountingDelete(CountingBloomFilter* bf, const void* str, size_t size);
+// Returns 0 when the key may be present and 1 when it is definitely absent
+int CountingCheck(CountingBloomFilter* bf, const void* str, size_t size);
+// Batch forms over n fixed-size keys stored back to back in keys. Keys are
+// hashed a batch at a time and every block is prefetched before it is touched.
+void CountingPutBatch(CountingBloomFilter* bf, const void* keys, size_t key_size, size_t n);
+void CountingDeleteBatch(CountingBloomFilter* bf, const void* keys, size_t key_size, size_t n);
+// Sets bit i of result (n / 64 rounded up words) when key i may be present
+void CountingCheckBatch(CountingBloomFilter* bf, const void* keys, size_t key_size, size_t n, uint64_t* result);
+// Expected FPP of a filter holding n keys in num_blocks blocks with k probes
+double CountingBloomFpp(double n, uint64_t num_blocks, int k);
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _CBF_
@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "filter/block.h"
+#include "gbf.h"
+#include "../hashing/hashing.h"
+#include "../SplitBlockBloomFilter/kernels/sbbf_kernels.h"
+
+#define GBF_BATCH 64
+
+// Adds level bf->num_levels with twice the capacity of the one before it.
+// Returns 0 on success.
+static int addLevel(GrowableBloomFilter* bf){
+    int i = bf->num_levels;
+    uint64_t capacity = i == 0 ? bf->capacity[0] : 2 * bf->capacity[i - 1];
+    double fpp = bf->fpp * 6 / (M_PI * M_PI) / ((i + 1.0) * (i + 1.0));
+    if(libfilter_block_init(libfilter_block_bytes_needed(capacity, fpp), &bf->levels[i])){
+        printf("Memory Not allocated!\n");
+        return -1;
+    }
+    bf->capacity[i] = capacity;
+    bf->num_levels = i + 1;
+    bf->ttl = capacity;
+    return 0;
+}
+
+// Makes room for one more key in the newest level. Past GBF_MAX_LEVELS, or when
+// a level cannot be allocated, keys keep going into the newest level and the
+// FPP drifts above target.
+static void reserve(GrowableBloomFilter* bf){
+    if(bf->ttl <= 0 && bf->num_levels < GBF_MAX_LEVELS){
+        addLevel(bf);
+    }
+}
+
+GrowableBloomFilter* createGrowableBloomFilter(long int initial_ndv, double fpp){
+    GrowableBloomFilter* bf = (GrowableBloomFilter*)malloc(sizeof(GrowableBloomFilter));
+    if(bf == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    bf->capacity[0] = initial_ndv > 0 ? initial_ndv : 1;
+    bf->num_levels = 0;
+    bf->count = 0;
+    bf->fpp = fpp;
+    bf->seed = 0x9a0b1e;
+    bf->kernel = SbbfSelectKernel();
+    bf->Insert = GrowableInsert;
+    bf->CheckKey = GrowableCheckKey;
+    if(addLevel(bf)){
+        free(bf);
+        return NULL;
+    }
+    return bf;
+}
+
+void DestroyGrowableBloomFilter(GrowableBloomFilter* bf){
+    for(int i = 0; i < bf->num_levels; i++){
+        libfilter_block_destruct(&bf->levels[i]);
+    }
+    free(bf);
+}
+
+static void insertHash(GrowableBloomFilter* bf, uint64_t hash){
+    reserve(bf);
+    bf->kernel->AddHash(hash, &bf->levels[bf->num_levels - 1]);
+    bf->ttl--;
+    bf->count++;
+}
+
+static int findHash(GrowableBloomFilter* bf, uint64_t hash){
+    for(int i = bf->num_levels - 1; i >= 0; i--){
+        if(bf->kernel->FindHash(hash, &bf->levels[i])){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void insertHashes(GrowableBloomFilter* bf, const uint64_t* hashes, size_t count){
+    // A batch may cross the end of a level
+    for(size_t done = 0; done < count;){
+        reserve(bf);
+        size_t take = count - done;
+        if(bf->ttl > 0 && (uint64_t)bf->ttl < take){
+            take = bf->ttl;
+        }
+        bf->kernel->AddBatch(hashes + done, take, &bf->levels[bf->num_levels - 1]);
+        bf->ttl -= take;
+        bf->count += take;
+        done += take;
+    }
+}
+
+static uint64_t findHashes(GrowableBloomFilter* bf, const uint64_t* hashes, size_t count){
+    uint64_t all = count == 64 ? ~0ULL : (1ULL << count) - 1;
+    uint64_t found = 0;
+    for(int i = bf->num_levels - 1; i >= 0 && found != all; i--){
+        found |= bf->kernel->FindBatch(hashes, count, &bf->levels[i]);
+    }
+    return found;
+}
+
+void GrowableInsert(GrowableBloomFilter* bf, const void* str, size_t size){
+    insertHash(bf, HashKey64(str, size, bf->seed));
+}
+
+int GrowableCheckKey(GrowableBloomFilter* bf, const void* str, size_t size){
+    return !findHash(bf, HashKey64(str, size, bf->seed));
+}
+
+void GrowableInsertBatch(GrowableBloomFilter* bf, const void* keys, size_t key_size, size_t n){
+    const char* key = (const char*)keys;
+    uint64_t hashes[GBF_BATCH];
+    for(size_t start = 0; start < n; start += GBF_BATCH){
+        size_t count = n - start < GBF_BATCH ? n - start : GBF_BATCH;
+        HashKeys64(key + start * key_size, key_size, count, bf->seed, hashes);
+        insertHashes(bf, hashes, count);
+    }
+}
+
+void GrowableCheckKeyBatch(GrowableBloomFilter* bf, const void* keys, size_t key_size, size_t n, uint64_t* result){
+    const char* key = (const char*)keys;
+    uint64_t hashes[GBF_BATCH];
+    for(size_t start = 0; start < n; start += GBF_BATCH){
+        size_t count = n - start < GBF_BATCH ? n - start : GBF_BATCH;
+        HashKeys64(key + start * key_size, key_size, count, bf->seed, hashes);
+        result[start / GBF_BATCH] = findHashes(bf, hashes, count);
+    }
+}
+
+void GrowableInsertU64(GrowableBloomFilter* bf, uint64_t key){
+    insertHash(bf, HashU64(key, bf->seed));
+}
+
+int GrowableCheckKeyU64(GrowableBloomFilter* bf, uint64_t key){
+    return !findHash(bf, HashU64(key, bf->seed));
+}
+
+void GrowableInsertU64Batch(GrowableBloomFilter* bf, const uint64_t* keys, size_t n){
+    uint64_t hashes[GBF_BATCH];
+    for(size_t start = 0; start < n; start += GBF_BATCH){
+        size_t count = n - start < GBF_BATCH ? n - start : GBF_BATCH;
+        HashKeysU64(keys + start, count, bf->seed, hashes);
+        insertHashes(bf, hashes, count);
+    }
+}
+
+void GrowableCheckKeyU64Batch(GrowableBloomFilter* bf, const uint64_t* keys, size_t n, uint64_t* result){
+    uint64_t hashes[GBF_BATCH];
+    for(size_t start = 0; start < n; start += GBF_BATCH){
+        size_t count = n - start < GBF_BATCH ? n - start : GBF_BATCH;
+        HashKeysU64(keys + start, count, bf->seed, hashes);
+        result[start / GBF_BATCH] = findHashes(bf, hashes, count);
+    }
+}
+
+uint64_t GrowableSizeInBytes(const GrowableBloomFilter* bf){
+    uint64_t bytes = 0;
+    for(int i = 0; i < bf->num_levels; i++){
+        bytes += libfilter_block_size_in_bytes(&bf->levels[i]);
+    }
+    return bytes;
+}
+
+double GrowableFpp(const GrowableBloomFilter* bf){
+    // A key is a false positive unless every level rejects it. Every level but
+    // the newest is full; the newest holds the rest.
+    double miss = 1;
+    uint64_t rest = bf->count;
+    for(int i = 0; i < bf->num_levels; i++){
+        uint64_t keys = i == bf->num_levels - 1 || rest < bf->capacity[i] ? rest : bf->capacity[i];
+        miss *= 1 - libfilter_block_fpp(keys, libfilter_block_size_in_bytes(&bf->levels[i]));
+        rest -= keys;
+    }
+    return 1 - miss;
+}
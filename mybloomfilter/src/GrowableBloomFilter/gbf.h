@@ -0,0 +1,66 @@
+#ifndef _GBF_
+#define _GBF_
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include "filter/block.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//-----------------------------------------------------------------------------
+
+// A split block filter that grows as keys arrive, following the taffy block
+// scheme: keys go into the newest level, and once it holds the keys it was sized
+// for a new level with twice the capacity is added. Level i is built for FPP
+// 6 fpp / (pi^2 (i+1)^2), so the FPPs of all levels sum to less than fpp however
+// far the filter grows, while bits per key only grow with the log of the level
+// count. Lookups probe every level, newest (and largest) first.
+
+#define GBF_MAX_LEVELS 48
+
+typedef struct GrowableBloomFilter {
+    libfilter_block levels[GBF_MAX_LEVELS];
+    uint64_t capacity[GBF_MAX_LEVELS];   // Keys level i was sized for
+    const struct SbbfKernel *kernel;     // SIMD bucket kernel chosen for this CPU
+    int num_levels;
+    int64_t ttl;                         // Inserts left before the newest level is full
+    uint64_t count;                      // Keys inserted
+    double fpp;                          // Target false positive probability
+    uint32_t seed;                       // Seed of the key hash
+    void (*Insert)(struct GrowableBloomFilter* bf, const void* str, size_t size);
+    int (*CheckKey)(struct GrowableBloomFilter* bf, const void* str, size_t size);
+} GrowableBloomFilter;
+
+// initial_ndv only sizes the first level; any number of keys can be inserted
+GrowableBloomFilter* createGrowableBloomFilter(long int initial_ndv, double fpp);
+void DestroyGrowableBloomFilter(GrowableBloomFilter* bf);
+void GrowableInsert(GrowableBloomFilter* bf, const void* str, size_t size);
+// Returns 0 when the key may be present and 1 when it is definitely absent
+int GrowableCheckKey(GrowableBloomFilter* bf, const void* str, size_t size);
+// Batch forms over n fixed-size keys stored back to back, as InsertBatch and
+// CheckKeyBatch of the split block filter
+void GrowableInsertBatch(GrowableBloomFilter* bf, const void* keys, size_t key_size, size_t n);
+void GrowableCheckKeyBatch(GrowableBloomFilter* bf, const void* keys, size_t key_size, size_t n, uint64_t* result);
+// Fast path for 64-bit integer keys, as InsertU64 and CheckKeyU64 of the split
+// block filter
+void GrowableInsertU64(GrowableBloomFilter* bf, uint64_t key);
+int GrowableCheckKeyU64(GrowableBloomFilter* bf, uint64_t key);
+void GrowableInsertU64Batch(GrowableBloomFilter* bf, const uint64_t* keys, size_t n);
+void GrowableCheckKeyU64Batch(GrowableBloomFilter* bf, const uint64_t* keys, size_t n, uint64_t* result);
+// Bytes of all levels
+uint64_t GrowableSizeInBytes(const GrowableBloomFilter* bf);
+// Expected FPP for the keys inserted so far
+double GrowableFpp(const GrowableBloomFilter* bf);
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _GBF_
@@ -0,0 +1,396 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "ribbon.h"
+#include "../hashing/hashing.h"
+#include "../parallel/parallel_build.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define AVX2 __attribute__((target("avx2")))
+#endif
+
+#define RIBBON_WIDTH 64
+#define RIBBON_MAX_COLUMNS 32
+// Zero words after the last block: a lookup in it reads the next block's
+// columns, and the AVX2 path reads up to three words past those
+#define RIBBON_PADDING (RIBBON_MAX_COLUMNS + 4)
+// Lookups per prefetch batch
+#define RIBBON_BATCH 64
+#define RIBBON_MAX_ATTEMPTS 32
+// Keys are banded in order of the top bits of their hash, which keeps the
+// rows being eliminated in cache
+#define RIBBON_SORT_BITS 12
+// Slots per key beyond one. With 64-bit rows the system is solvable for 95%
+// or more of seeds at this slack, for any key count tried up to 10M; at 5% it
+// already fails for most seeds at 100K keys.
+#define RIBBON_OVERHEAD 0.12
+
+// MurmurHash3's 64-bit finalizer; remixing the key hash with a new seed gives
+// a fresh system without hashing the keys again
+static inline uint64_t keyHash(uint64_t hash, uint64_t seed){
+    uint64_t h = hash + seed;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// The start comes from the high bits by multiply-shift; the row and the
+// fingerprint are further mixes of the whole hash, so keys with nearby starts
+// still get unrelated rows
+static inline uint64_t startOf(const RibbonFilter* rf, uint64_t hash){
+    return (uint64_t)(((unsigned __int128)hash * rf->num_starts) >> 64);
+}
+
+// Bit 0 is always set, so the row's first slot is its pivot
+static inline uint64_t coefficientsOf(uint64_t hash){
+    uint64_t c = (hash ^ (hash >> 31)) * 0xbf58476d1ce4e5b9ULL;
+    return (c ^ (c >> 29)) | 1;
+}
+
+static inline uint32_t fingerprintOf(uint64_t hash){
+    return (uint32_t)((hash * 0x94d049bb133111ebULL) >> 32);
+}
+
+static inline int columnsOf(const RibbonFilter* rf, uint64_t block){
+    return rf->result_bits + (block >= rf->upper_block);
+}
+
+static inline uint64_t offsetOf(const RibbonFilter* rf, uint64_t block){
+    return block * rf->result_bits + (block > rf->upper_block ? block - rf->upper_block : 0);
+}
+
+static inline uint32_t maskOf(int columns){
+    return (uint32_t)((1ULL << columns) - 1);
+}
+
+static uint64_t blocksFor(size_t n){
+    return (uint64_t)ceil((n * (1 + RIBBON_OVERHEAD) + RIBBON_WIDTH - 1) / RIBBON_WIDTH);
+}
+
+// Spreads total_words column words over the blocks, the extra ones going to
+// the top blocks. At least one column is kept everywhere.
+static void setColumns(RibbonFilter* rf, uint64_t total_words){
+    uint64_t columns = total_words / rf->num_blocks;
+    uint64_t extra = total_words % rf->num_blocks;
+    if(columns < 1){
+        columns = 1;
+        extra = 0;
+    }
+    if(columns >= RIBBON_MAX_COLUMNS){
+        columns = RIBBON_MAX_COLUMNS;
+        extra = 0;
+    }
+    rf->result_bits = (int)columns;
+    rf->upper_block = rf->num_blocks - extra;
+}
+
+double RibbonBitsPerKey(size_t n, double fpp){
+    if(n == 0){
+        return 0;
+    }
+    // With r columns in a block and r + 1 in the rest, a fraction h of keys in
+    // the wider blocks gives an FPP of (1 - h) / 2^r + h / 2^(r + 1)
+    double r = floor(-log2(fpp));
+    double h = 2 * (1 - fpp * exp2(r));
+    return (r + h) * blocksFor(n) * RIBBON_WIDTH / n;
+}
+
+double RibbonFpp(const RibbonFilter* rf){
+    uint64_t upper_starts = rf->num_starts > rf->upper_block * RIBBON_WIDTH ?
+                            rf->num_starts - rf->upper_block * RIBBON_WIDTH : 0;
+    double lower = ldexp((double)(rf->num_starts - upper_starts), -rf->result_bits);
+    double upper = ldexp((double)upper_starts, -rf->result_bits - 1);
+    return (lower + upper) / rf->num_starts;
+}
+
+//-----------------------------------------------------------------------------
+// Construction
+
+// Adds a key's row to the band by Gaussian elimination: while the row's pivot
+// slot is taken, XOR the row stored there into it and move the pivot to the
+// next set bit. Returns -1 when the row cancels out but its fingerprint does
+// not, which makes the system unsolvable.
+static inline int band(uint64_t* rows, uint32_t* results, uint64_t start, uint64_t row, uint32_t result){
+    for(;;){
+        uint64_t existing = rows[start];
+        if(existing == 0){
+            rows[start] = row;
+            results[start] = result;
+            return 0;
+        }
+        row ^= existing;
+        result ^= results[start];
+        if(row == 0){
+            return result == 0 ? 0 : -1;
+        }
+        int skip = __builtin_ctzll(row);
+        row >>= skip;
+        start += skip;
+    }
+}
+
+// Solves the band from the last slot down. state[j] holds the solution of
+// column j for the 64 slots from the current one up, so each slot's value is
+// its fingerprint bit XOR the parity of its row against the slots above it.
+static void backSubstitute(RibbonFilter* rf, const uint64_t* rows, const uint32_t* results){
+    uint64_t state[RIBBON_MAX_COLUMNS] = {0};
+    for(uint64_t block = rf->num_blocks; block-- > 0;){
+        int columns = columnsOf(rf, block);
+        for(int slot = RIBBON_WIDTH - 1; slot >= 0; slot--){
+            uint64_t row = rows[block * RIBBON_WIDTH + slot];
+            uint32_t result = results[block * RIBBON_WIDTH + slot];
+            for(int j = 0; j < columns; j++){
+                uint64_t above = state[j] << 1;
+                state[j] = above | ((__builtin_parityll(above & row) ^ (result >> j)) & 1);
+            }
+        }
+        memcpy(rf->solution + offsetOf(rf, block), state, columns * sizeof(uint64_t));
+    }
+}
+
+// Mixes the hashes with the filter's seed and counting-sorts them by their top
+// bits into sorted
+static void mixAndSort(const RibbonFilter* rf, const uint64_t* hashes, size_t n, uint64_t* mixed,
+                       uint64_t* sorted, size_t* histogram){
+    memset(histogram, 0, (1 << RIBBON_SORT_BITS) * sizeof(size_t));
+    for(size_t i = 0; i < n; i++){
+        mixed[i] = keyHash(hashes[i], rf->seed);
+        histogram[mixed[i] >> (64 - RIBBON_SORT_BITS)]++;
+    }
+    size_t sum = 0;
+    for(size_t b = 0; b < (1 << RIBBON_SORT_BITS); b++){
+        size_t count = histogram[b];
+        histogram[b] = sum;
+        sum += count;
+    }
+    for(size_t i = 0; i < n; i++){
+        sorted[histogram[mixed[i] >> (64 - RIBBON_SORT_BITS)]++] = mixed[i];
+    }
+}
+
+static RibbonFilter* buildFromHashes(const uint64_t* hashes, size_t n, double bits_per_key){
+    if(!(bits_per_key >= 0)){
+        printf("Bad bits per key!\n");
+        return NULL;
+    }
+    RibbonFilter* rf = (RibbonFilter*)malloc(sizeof(RibbonFilter));
+    if(rf == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    rf->num_keys = n;
+    rf->seed = 0x2d358dccaa6c78a5ULL;
+    rf->CheckKey = RibbonCheckKey;
+    rf->num_blocks = blocksFor(n);
+    // Column words per block, kept when the band is widened so the FPP holds
+    double words_per_block = bits_per_key * n / RIBBON_WIDTH / rf->num_blocks;
+    uint64_t total_words = (uint64_t)ceil(bits_per_key * n / RIBBON_WIDTH);
+
+    uint64_t* mixed = (uint64_t*)malloc((n > 0 ? n : 1) * sizeof(uint64_t));
+    uint64_t* sorted = (uint64_t*)malloc((n > 0 ? n : 1) * sizeof(uint64_t));
+    size_t* histogram = (size_t*)malloc((1 << RIBBON_SORT_BITS) * sizeof(size_t));
+    uint64_t* rows = NULL;
+    uint32_t* results = NULL;
+    int built = 0;
+    if(mixed == NULL || sorted == NULL || histogram == NULL){
+        printf("Memory Not allocated!\n");
+    }
+    for(int attempt = 0; mixed != NULL && sorted != NULL && histogram != NULL && attempt < RIBBON_MAX_ATTEMPTS; attempt++){
+        if(attempt > 0 && attempt % 4 == 0){
+            // A few unlucky seeds in a row mean the band is too tight for n
+            rf->num_blocks += rf->num_blocks / 32 + 1;
+            total_words = (uint64_t)ceil(words_per_block * rf->num_blocks);
+        }
+        rf->num_starts = rf->num_blocks * RIBBON_WIDTH - (RIBBON_WIDTH - 1);
+        free(rows);
+        free(results);
+        rows = (uint64_t*)calloc(rf->num_blocks * RIBBON_WIDTH, sizeof(uint64_t));
+        results = (uint32_t*)calloc(rf->num_blocks * RIBBON_WIDTH, sizeof(uint32_t));
+        if(rows == NULL || results == NULL){
+            printf("Memory Not allocated!\n");
+            break;
+        }
+        mixAndSort(rf, hashes, n, mixed, sorted, histogram);
+        size_t i = 0;
+        for(; i < n; i++){
+            uint64_t hash = sorted[i];
+            if(band(rows, results, startOf(rf, hash), coefficientsOf(hash), fingerprintOf(hash)) != 0){
+                break;
+            }
+        }
+        if(i == n){
+            built = 1;
+            break;
+        }
+        rf->seed = keyHash(rf->seed, 0x9e3779b97f4a7c15ULL);
+    }
+    free(mixed);
+    free(sorted);
+    free(histogram);
+
+    rf->solution = NULL;
+    if(built){
+        setColumns(rf, total_words);
+        uint64_t words = offsetOf(rf, rf->num_blocks) + RIBBON_PADDING;
+        rf->solution = (uint64_t*)aligned_alloc(64, (words * sizeof(uint64_t) + 63) / 64 * 64);
+        if(rf->solution == NULL){
+            printf("Memory Not allocated!\n");
+        }else{
+            memset(rf->solution, 0, words * sizeof(uint64_t));
+            backSubstitute(rf, rows, results);
+        }
+    }
+    free(rows);
+    free(results);
+    if(rf->solution == NULL){
+        free(rf);
+        return NULL;
+    }
+    return rf;
+}
+
+typedef struct {
+    const char* keys;
+    size_t key_size;
+    uint64_t* hashes;
+} FixedKeys;
+
+static void hashFixedKeys(void* ctx, size_t begin, size_t end){
+    FixedKeys* k = (FixedKeys*)ctx;
+    HashKeys64(k->keys + begin * k->key_size, k->key_size, end - begin, RIBBON_FILTER_SEED, k->hashes + begin);
+}
+
+RibbonFilter* BuildRibbonFilterFromKeys(const void* keys, size_t key_size, size_t n,
+                                        double bits_per_key, int threads){
+    uint64_t* hashes = (uint64_t*)malloc((n > 0 ? n : 1) * sizeof(uint64_t));
+    if(hashes == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    FixedKeys k = {(const char*)keys, key_size, hashes};
+    ParallelFor(n, threads, hashFixedKeys, &k);
+    RibbonFilter* rf = buildFromHashes(hashes, n, bits_per_key);
+    free(hashes);
+    return rf;
+}
+
+RibbonFilter* BuildRibbonFilterFromHashes(const uint64_t* hashes, size_t n, double bits_per_key){
+    return buildFromHashes(hashes, n, bits_per_key);
+}
+
+void DestroyRibbonFilter(RibbonFilter* rf){
+    free(rf->solution);
+    free(rf);
+}
+
+//-----------------------------------------------------------------------------
+// Lookup
+
+// Where a key's columns are: lo[j] and lo[columns + j] hold column j of the
+// key's block and the next one, and its window starts shift bits into lo
+typedef struct {
+    const uint64_t* lo;
+    uint64_t row;
+    uint32_t fingerprint;
+    int shift;
+    int columns;
+} Probe;
+
+static inline void probeOf(const RibbonFilter* rf, uint64_t hash, Probe* p){
+    uint64_t start = startOf(rf, hash);
+    uint64_t block = start / RIBBON_WIDTH;
+    p->lo = rf->solution + offsetOf(rf, block);
+    p->row = coefficientsOf(hash);
+    p->fingerprint = fingerprintOf(hash);
+    p->shift = (int)(start % RIBBON_WIDTH);
+    p->columns = columnsOf(rf, block);
+}
+
+// The window of column j: shifting hi by 64 - shift in two steps keeps a zero
+// shift defined
+static inline int findProbe(const Probe* p){
+    const uint64_t* hi = p->lo + p->columns;
+    uint32_t computed = 0;
+    for(int j = 0; j < p->columns; j++){
+        uint64_t window = (p->lo[j] >> p->shift) | ((hi[j] << 1) << (63 - p->shift));
+        computed |= (uint32_t)__builtin_parityll(window & p->row) << j;
+    }
+    return ((computed ^ p->fingerprint) & maskOf(p->columns)) == 0;
+}
+
+#if defined(__x86_64__)
+// Four columns per step; AVX2 has no 64-bit popcount, so the parity of each
+// lane is folded down to its low bit and moved into the sign bit
+AVX2 static inline int findProbeAvx2(const Probe* p){
+    const uint64_t* hi = p->lo + p->columns;
+    __m256i row = _mm256_set1_epi64x((long long)p->row);
+    __m256i right = _mm256_set1_epi64x(p->shift);
+    __m256i left = _mm256_set1_epi64x(63 - p->shift);
+    uint32_t computed = 0;
+    for(int j = 0; j < p->columns; j += 4){
+        __m256i lo = _mm256_loadu_si256((const __m256i*)(p->lo + j));
+        __m256i up = _mm256_slli_epi64(_mm256_loadu_si256((const __m256i*)(hi + j)), 1);
+        __m256i w = _mm256_and_si256(_mm256_or_si256(_mm256_srlv_epi64(lo, right), _mm256_sllv_epi64(up, left)), row);
+        w = _mm256_xor_si256(w, _mm256_srli_epi64(w, 32));
+        w = _mm256_xor_si256(w, _mm256_srli_epi64(w, 16));
+        w = _mm256_xor_si256(w, _mm256_srli_epi64(w, 8));
+        w = _mm256_xor_si256(w, _mm256_srli_epi64(w, 4));
+        w = _mm256_xor_si256(w, _mm256_srli_epi64(w, 2));
+        w = _mm256_xor_si256(w, _mm256_srli_epi64(w, 1));
+        computed |= (uint32_t)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_slli_epi64(w, 63))) << j;
+    }
+    return ((computed ^ p->fingerprint) & maskOf(p->columns)) == 0;
+}
+
+AVX2 static uint64_t findProbesAvx2(const Probe* probes, size_t count){
+    uint64_t found = 0;
+    for(size_t i = 0; i < count; i++){
+        found |= (uint64_t)findProbeAvx2(&probes[i]) << i;
+    }
+    return found;
+}
+#endif
+
+static uint64_t findProbes(const Probe* probes, size_t count){
+#if defined(__x86_64__)
+    if(__builtin_cpu_supports("avx2")){
+        return findProbesAvx2(probes, count);
+    }
+#endif
+    uint64_t found = 0;
+    for(size_t i = 0; i < count; i++){
+        found |= (uint64_t)findProbe(&probes[i]) << i;
+    }
+    return found;
+}
+
+int RibbonCheckKey(RibbonFilter* rf, const void* str, size_t size){
+    Probe p;
+    probeOf(rf, keyHash(HashKey64(str, size, RIBBON_FILTER_SEED), rf->seed), &p);
+    return !findProbe(&p);
+}
+
+void RibbonCheckKeyBatch(RibbonFilter* rf, const void* keys, size_t key_size, size_t n, uint64_t* result){
+    const char* key = (const char*)keys;
+    uint64_t hashes[RIBBON_BATCH];
+    Probe probes[RIBBON_BATCH];
+    for(size_t start = 0; start < n; start += RIBBON_BATCH){
+        size_t count = n - start < RIBBON_BATCH ? n - start : RIBBON_BATCH;
+        HashKeys64(key + start * key_size, key_size, count, RIBBON_FILTER_SEED, hashes);
+        for(size_t i = 0; i < count; i++){
+            probeOf(rf, keyHash(hashes[i], rf->seed), &probes[i]);
+            __builtin_prefetch(probes[i].lo);
+            __builtin_prefetch(probes[i].lo + 2 * probes[i].columns - 1);
+        }
+        result[start / RIBBON_BATCH] = findProbes(probes, count);
+    }
+}
+
+uint64_t RibbonSizeInBytes(const RibbonFilter* rf){
+    return offsetOf(rf, rf->num_blocks) * sizeof(uint64_t);
+}
@@ -0,0 +1,72 @@
+#ifndef _RIBBON_FILTER_
+#define _RIBBON_FILTER_
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//-----------------------------------------------------------------------------
+
+// A standard Ribbon filter (Dillinger and Walzer, 2021) with 64-bit wide rows:
+// every key gets a window of 64 consecutive slots and a random 64-bit
+// coefficient row over it, and is present when the parity of the row ANDed
+// with each stored column equals the matching bit of its fingerprint. Building
+// it means solving that banded linear system over GF(2), which costs more than
+// filling a Bloom filter, but the result needs only about 12% more space than
+// its FPP strictly requires: about 7.5 bits per key at 1%, where a split block
+// filter takes 10.5.
+//
+// The slots are stored 64 at a time, one 64-bit word per column, so a lookup
+// reads two adjacent words per column. Blocks below upper_block hold
+// result_bits columns and the rest result_bits + 1, which makes any fractional
+// number of bits per key possible.
+
+typedef struct RibbonFilter {
+    uint64_t *solution;        // Column words block after block, then a zero padding block
+    uint64_t num_blocks;       // 64-slot blocks
+    uint64_t num_starts;       // Slots a key's window can start at, num_blocks * 64 - 63
+    uint64_t upper_block;      // First block with result_bits + 1 columns
+    uint64_t seed;             // Remixes the key hashes; a build that fails retries with another
+    uint64_t num_keys;         // Keys the filter was built from
+    int result_bits;           // Columns in the blocks below upper_block, 1 to 32
+    int (*CheckKey)(struct RibbonFilter* rf, const void* str, size_t size);
+} RibbonFilter;
+
+// Seed the builders hash keys with, for callers that hash keys themselves
+#define RIBBON_FILTER_SEED 0x71bb0
+
+// Bits per key that give n keys the given FPP
+double RibbonBitsPerKey(size_t n, double fpp);
+// Builds a filter taking bits_per_key * n bits (rounded up to 64) from n
+// fixed-size keys stored back to back, or proportionally more in the rare case
+// that the band has to be widened to solve. Keys are hashed with the given number
+// of threads; solving the system is sequential. Returns NULL on error.
+RibbonFilter* BuildRibbonFilterFromKeys(const void* keys, size_t key_size, size_t n,
+                                        double bits_per_key, int threads);
+// Same, over HashKey64(key, size, RIBBON_FILTER_SEED) of every key
+RibbonFilter* BuildRibbonFilterFromHashes(const uint64_t* hashes, size_t n, double bits_per_key);
+void DestroyRibbonFilter(RibbonFilter* rf);
+// Returns 0 when the key may be present and 1 when it is definitely absent
+int RibbonCheckKey(RibbonFilter* rf, const void* str, size_t size);
+// Sets bit i of result (n / 64 rounded up words) when key i may be present.
+// The solution words of every key in a batch are prefetched before any is
+// read, and the columns are checked four at a time with AVX2 when the running
+// CPU has it.
+void RibbonCheckKeyBatch(RibbonFilter* rf, const void* keys, size_t key_size, size_t n, uint64_t* result);
+uint64_t RibbonSizeInBytes(const RibbonFilter* rf);
+// FPP of a key that was not inserted
+double RibbonFpp(const RibbonFilter* rf);
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _RIBBON_FILTER_
@@ -0,0 +1,370 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "cms.h"
+#include "../hashing/hashing.h"
+
+// Narrowest row, one cache line of counters
+#define CMS_MIN_WIDTH 8
+// Widest row, far past any sketch that fits in memory
+#define CMS_MAX_WIDTH (1ULL << 40)
+
+static uint64_t widthFor(double width){
+    uint64_t w = CMS_MIN_WIDTH;
+    while(w < width && w < CMS_MAX_WIDTH){
+        w <<= 1;
+    }
+    return w;
+}
+
+static int depthFor(double delta){
+    int depth = (int)ceil(log(1 / delta));
+    if(depth < 1){
+        return 1;
+    }
+    return depth > CMS_MAX_DEPTH ? CMS_MAX_DEPTH : depth;
+}
+
+static int validShape(double epsilon, double delta){
+    if(!(epsilon > 0 && epsilon < 1 && delta > 0 && delta < 1)){
+        printf("A sketch takes epsilon and delta between 0 and 1!\n");
+        return 0;
+    }
+    return 1;
+}
+
+// Zeroed rows of 8-byte counters; width is at least CMS_MIN_WIDTH, so the size
+// is a multiple of the alignment
+static void* allocCounters(uint64_t width, int depth){
+    void* counts = aligned_alloc(64, width * depth * sizeof(uint64_t));
+    if(counts == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    memset(counts, 0, width * depth * sizeof(uint64_t));
+    return counts;
+}
+
+// Counter of row r for a key hash; the top bit is the Count-Sketch sign
+static inline uint64_t rowHash(uint64_t hash, int r){
+    return HashU64(hash, (uint32_t)r);
+}
+
+//-----------------------------------------------------------------------------
+// Count-Min
+
+static CountMinSketch* newCountMin(uint64_t width, int depth, int conservative){
+    CountMinSketch* cms = (CountMinSketch*)malloc(sizeof(CountMinSketch));
+    if(cms == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    cms->counts = (uint64_t*)allocCounters(width, depth);
+    if(cms->counts == NULL){
+        free(cms);
+        return NULL;
+    }
+    cms->width = width;
+    cms->depth = depth;
+    cms->conservative = conservative != 0;
+    cms->total = 0;
+    cms->seed = CMS_SEED;
+    cms->Add = CountMinAdd;
+    cms->Estimate = CountMinEstimate;
+    return cms;
+}
+
+CountMinSketch* createCountMinSketch(double epsilon, double delta, int conservative){
+    if(!validShape(epsilon, delta)){
+        return NULL;
+    }
+    return newCountMin(widthFor(exp(1) / epsilon), depthFor(delta), conservative);
+}
+
+void DestroyCountMinSketch(CountMinSketch* cms){
+    free(cms->counts);
+    free(cms);
+}
+
+void CountMinAddHash(CountMinSketch* cms, uint64_t hash, uint64_t count){
+    uint64_t mask = cms->width - 1;
+    cms->total += count;
+    if(!cms->conservative){
+        for(int r = 0; r < cms->depth; r++){
+            cms->counts[r * cms->width + (rowHash(hash, r) & mask)] += count;
+        }
+        return;
+    }
+    // Raise every counter of the key to at least its current estimate plus
+    // count, and leave those already above it
+    uint64_t* cells[CMS_MAX_DEPTH];
+    uint64_t low = UINT64_MAX;
+    for(int r = 0; r < cms->depth; r++){
+        cells[r] = &cms->counts[r * cms->width + (rowHash(hash, r) & mask)];
+        if(*cells[r] < low){
+            low = *cells[r];
+        }
+    }
+    for(int r = 0; r < cms->depth; r++){
+        if(*cells[r] < low + count){
+            *cells[r] = low + count;
+        }
+    }
+}
+
+void CountMinAdd(CountMinSketch* cms, const void* str, size_t size, uint64_t count){
+    CountMinAddHash(cms, HashKey64(str, size, cms->seed), count);
+}
+
+uint64_t CountMinEstimateHash(const CountMinSketch* cms, uint64_t hash){
+    uint64_t mask = cms->width - 1;
+    uint64_t low = UINT64_MAX;
+    for(int r = 0; r < cms->depth; r++){
+        uint64_t c = cms->counts[r * cms->width + (rowHash(hash, r) & mask)];
+        if(c < low){
+            low = c;
+        }
+    }
+    return low;
+}
+
+uint64_t CountMinEstimate(const CountMinSketch* cms, const void* str, size_t size){
+    return CountMinEstimateHash(cms, HashKey64(str, size, cms->seed));
+}
+
+uint64_t CountMinSizeInBytes(const CountMinSketch* cms){
+    return cms->width * cms->depth * sizeof(uint64_t);
+}
+
+int CountMinMerge(CountMinSketch* dst, const CountMinSketch* src){
+    if(dst->width != src->width || dst->depth != src->depth || dst->seed != src->seed){
+        printf("Only sketches of the same width, depth and seed can be merged!\n");
+        return -1;
+    }
+    uint64_t n = dst->width * dst->depth;
+    for(uint64_t i = 0; i < n; i++){
+        dst->counts[i] += src->counts[i];
+    }
+    dst->total += src->total;
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Count-Sketch
+
+static CountSketch* newCountSketch(uint64_t width, int depth){
+    CountSketch* cs = (CountSketch*)malloc(sizeof(CountSketch));
+    if(cs == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    cs->counts = (int64_t*)allocCounters(width, depth);
+    if(cs->counts == NULL){
+        free(cs);
+        return NULL;
+    }
+    cs->width = width;
+    cs->depth = depth;
+    cs->total = 0;
+    cs->seed = CMS_SEED;
+    cs->Add = CountSketchAdd;
+    cs->Estimate = CountSketchEstimate;
+    return cs;
+}
+
+CountSketch* createCountSketch(double epsilon, double delta){
+    if(!validShape(epsilon, delta)){
+        return NULL;
+    }
+    return newCountSketch(widthFor(3 / (epsilon * epsilon)), depthFor(delta));
+}
+
+void DestroyCountSketch(CountSketch* cs){
+    free(cs->counts);
+    free(cs);
+}
+
+void CountSketchAddHash(CountSketch* cs, uint64_t hash, int64_t count){
+    uint64_t mask = cs->width - 1;
+    cs->total += count;
+    for(int r = 0; r < cs->depth; r++){
+        uint64_t h = rowHash(hash, r);
+        cs->counts[r * cs->width + (h & mask)] += (h >> 63) ? -count : count;
+    }
+}
+
+void CountSketchAdd(CountSketch* cs, const void* str, size_t size, int64_t count){
+    CountSketchAddHash(cs, HashKey64(str, size, cs->seed), count);
+}
+
+int64_t CountSketchEstimateHash(const CountSketch* cs, uint64_t hash){
+    uint64_t mask = cs->width - 1;
+    int64_t values[CMS_MAX_DEPTH];
+    for(int r = 0; r < cs->depth; r++){
+        uint64_t h = rowHash(hash, r);
+        int64_t v = cs->counts[r * cs->width + (h & mask)];
+        v = (h >> 63) ? -v : v;
+        // Insertion sort; there are at most CMS_MAX_DEPTH values
+        int i = r;
+        for(; i > 0 && values[i - 1] > v; i--){
+            values[i] = values[i - 1];
+        }
+        values[i] = v;
+    }
+    int mid = cs->depth / 2;
+    return cs->depth % 2 ? values[mid] : (values[mid - 1] + values[mid]) / 2;
+}
+
+int64_t CountSketchEstimate(const CountSketch* cs, const void* str, size_t size){
+    return CountSketchEstimateHash(cs, HashKey64(str, size, cs->seed));
+}
+
+uint64_t CountSketchSizeInBytes(const CountSketch* cs){
+    return cs->width * cs->depth * sizeof(int64_t);
+}
+
+int CountSketchMerge(CountSketch* dst, const CountSketch* src){
+    if(dst->width != src->width || dst->depth != src->depth || dst->seed != src->seed){
+        printf("Only sketches of the same width, depth and seed can be merged!\n");
+        return -1;
+    }
+    uint64_t n = dst->width * dst->depth;
+    for(uint64_t i = 0; i < n; i++){
+        dst->counts[i] += src->counts[i];
+    }
+    dst->total += src->total;
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Files
+
+static int saveSketch(CmsFileHeader* header, const void* counts, const char* path){
+    uint64_t bytes = header->width * header->depth * sizeof(uint64_t);
+    memcpy(header->magic, CMS_FILE_MAGIC, sizeof(header->magic));
+    header->version = CMS_FILE_VERSION;
+    header->hash_id = CMS_HASH_MURMUR3_X64_128_FOLDED;
+    header->payload_offset = CMS_FILE_PAYLOAD_OFFSET;
+    header->payload_bytes = bytes;
+    header->checksum = Checksum64(CHECKSUM64_BASIS, counts, bytes);
+
+    FILE* file = fopen(path, "wb");
+    if(file == NULL){
+        printf("Could not open %s for writing!\n", path);
+        return -1;
+    }
+    char padding[CMS_FILE_PAYLOAD_OFFSET] = {0};
+    memcpy(padding, header, sizeof(*header));
+    int ok = fwrite(padding, 1, sizeof(padding), file) == sizeof(padding) &&
+             fwrite(counts, 1, bytes, file) == bytes;
+    ok = (fclose(file) == 0) && ok;
+    if(!ok){
+        printf("Could not write %s!\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+int SaveCountMinSketch(const CountMinSketch* cms, const char* path){
+    CmsFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.seed = cms->seed;
+    header.kind = CMS_KIND_COUNT_MIN;
+    header.conservative = cms->conservative;
+    header.width = cms->width;
+    header.depth = cms->depth;
+    header.total = cms->total;
+    return saveSketch(&header, cms->counts, path);
+}
+
+int SaveCountSketch(const CountSketch* cs, const char* path){
+    CmsFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.seed = cs->seed;
+    header.kind = CMS_KIND_COUNT_SKETCH;
+    header.width = cs->width;
+    header.depth = cs->depth;
+    header.total = (uint64_t)cs->total;
+    return saveSketch(&header, cs->counts, path);
+}
+
+// Opens path and reads and checks its header. Returns the file, positioned at
+// the payload, or NULL on error.
+static FILE* openSketch(const char* path, uint32_t kind, CmsFileHeader* header){
+    FILE* file = fopen(path, "rb");
+    if(file == NULL){
+        printf("Could not open %s!\n", path);
+        return NULL;
+    }
+    if(fread(header, sizeof(*header), 1, file) != 1 ||
+       memcmp(header->magic, CMS_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+       header->version != CMS_FILE_VERSION ||
+       header->hash_id != CMS_HASH_MURMUR3_X64_128_FOLDED ||
+       header->seed != CMS_SEED ||
+       header->kind != kind ||
+       header->width < CMS_MIN_WIDTH || header->width > CMS_MAX_WIDTH ||
+       (header->width & (header->width - 1)) != 0 ||
+       header->depth < 1 || header->depth > CMS_MAX_DEPTH ||
+       header->payload_offset != CMS_FILE_PAYLOAD_OFFSET ||
+       header->payload_bytes != header->width * header->depth * sizeof(uint64_t) ||
+       fseek(file, (long)header->payload_offset, SEEK_SET) != 0){
+        printf("%s is not a %s file!\n", path, kind == CMS_KIND_COUNT_MIN ? "Count-Min sketch" : "Count-Sketch");
+        fclose(file);
+        return NULL;
+    }
+    return file;
+}
+
+// Reads the payload into counts and closes file. Returns 0 on success.
+static int readSketch(FILE* file, const char* path, const CmsFileHeader* header, void* counts, int verify){
+    int ok = fread(counts, 1, header->payload_bytes, file) == header->payload_bytes;
+    fclose(file);
+    if(!ok){
+        printf("Could not read %s!\n", path);
+        return -1;
+    }
+    if(verify && Checksum64(CHECKSUM64_BASIS, counts, header->payload_bytes) != header->checksum){
+        printf("%s failed its checksum!\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+CountMinSketch* OpenCountMinSketch(const char* path, int verify){
+    CmsFileHeader header;
+    FILE* file = openSketch(path, CMS_KIND_COUNT_MIN, &header);
+    if(file == NULL){
+        return NULL;
+    }
+    CountMinSketch* cms = newCountMin(header.width, (int)header.depth, header.conservative);
+    if(cms == NULL){
+        fclose(file);
+        return NULL;
+    }
+    cms->total = header.total;
+    if(readSketch(file, path, &header, cms->counts, verify) != 0){
+        DestroyCountMinSketch(cms);
+        return NULL;
+    }
+    return cms;
+}
+
+CountSketch* OpenCountSketch(const char* path, int verify){
+    CmsFileHeader header;
+    FILE* file = openSketch(path, CMS_KIND_COUNT_SKETCH, &header);
+    if(file == NULL){
+        return NULL;
+    }
+    CountSketch* cs = newCountSketch(header.width, (int)header.depth);
+    if(cs == NULL){
+        fclose(file);
+        return NULL;
+    }
+    cs->total = (int64_t)header.total;
+    if(readSketch(file, path, &header, cs->counts, verify) != 0){
+        DestroyCountSketch(cs);
+        return NULL;
+    }
+    return cs;
+}
@@ -0,0 +1,129 @@
+#ifndef _CMS_
+#define _CMS_
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//-----------------------------------------------------------------------------
+
+// Frequency sketches for heavy hitters: depth rows of width counters, where a
+// key adds its count to one counter per row.
+//
+// Count-Min keeps unsigned counters and estimates a key by its smallest
+// counter, which never undercounts. Sized by createCountMinSketch it is within
+// epsilon times the total count with probability 1 - delta. With conservative
+// update an add raises only the counters below the key's new lower bound, which
+// keeps the guarantee and often halves the overcount of rare keys, at the cost
+// of a read before every write and of deletes (negative counts).
+//
+// Count-Sketch keeps signed counters, adds +count or -count by a per-row sign
+// bit and estimates a key by the median of its signed counters. It is unbiased
+// and its error scales with the L2 norm of the counts rather than their sum,
+// so it is the better fit for skewed streams and takes deletes; conservative
+// update does not apply to it, as its counters are signed sums.
+//
+// Row r of a key with hash h uses HashU64(h, r): the counter from its low bits
+// and the Count-Sketch sign from its top bit. Keys are hashed with HashKey64
+// under CMS_SEED, the split block filter's default seed, so a hash taken once
+// with SbbfHashKey can also go to the AddHash calls.
+
+#define CMS_MAX_DEPTH 16
+#define CMS_SEED 0xfeedba
+
+typedef struct CountMinSketch {
+    uint64_t *counts;          // depth rows of width counters, 64-byte aligned
+    uint64_t width;            // A power of two
+    int depth;
+    int conservative;          // Non-zero for conservative update
+    uint64_t total;            // Sum of all counts added
+    uint32_t seed;             // Seed of the key hash
+    void (*Add)(struct CountMinSketch* cms, const void* str, size_t size, uint64_t count);
+    uint64_t (*Estimate)(const struct CountMinSketch* cms, const void* str, size_t size);
+} CountMinSketch;
+
+typedef struct CountSketch {
+    int64_t *counts;           // depth rows of width counters, 64-byte aligned
+    uint64_t width;            // A power of two
+    int depth;
+    int64_t total;             // Sum of all counts added
+    uint32_t seed;             // Seed of the key hash
+    void (*Add)(struct CountSketch* cs, const void* str, size_t size, int64_t count);
+    int64_t (*Estimate)(const struct CountSketch* cs, const void* str, size_t size);
+} CountSketch;
+
+// Width e / epsilon and depth ln(1 / delta), each rounded up, the width to a
+// power of two and the depth to at most CMS_MAX_DEPTH
+CountMinSketch* createCountMinSketch(double epsilon, double delta, int conservative);
+void DestroyCountMinSketch(CountMinSketch* cms);
+void CountMinAdd(CountMinSketch* cms, const void* str, size_t size, uint64_t count);
+void CountMinAddHash(CountMinSketch* cms, uint64_t hash, uint64_t count);
+// Never below the true count of the key
+uint64_t CountMinEstimate(const CountMinSketch* cms, const void* str, size_t size);
+uint64_t CountMinEstimateHash(const CountMinSketch* cms, uint64_t hash);
+uint64_t CountMinSizeInBytes(const CountMinSketch* cms);
+// Adds the counts of src to dst. They must have the same width, depth and
+// seed; returns 0 on success and -1 otherwise. Merging sketches built with
+// conservative update still never undercounts.
+int CountMinMerge(CountMinSketch* dst, const CountMinSketch* src);
+
+// Width 3 / epsilon^2 and depth ln(1 / delta), rounded up as for Count-Min; the
+// error is then within epsilon times the L2 norm of the counts with
+// probability 1 - delta
+CountSketch* createCountSketch(double epsilon, double delta);
+void DestroyCountSketch(CountSketch* cs);
+void CountSketchAdd(CountSketch* cs, const void* str, size_t size, int64_t count);
+void CountSketchAddHash(CountSketch* cs, uint64_t hash, int64_t count);
+int64_t CountSketchEstimate(const CountSketch* cs, const void* str, size_t size);
+int64_t CountSketchEstimateHash(const CountSketch* cs, uint64_t hash);
+uint64_t CountSketchSizeInBytes(const CountSketch* cs);
+// Adds the counts of src to dst, under the same conditions as CountMinMerge
+int CountSketchMerge(CountSketch* dst, const CountSketch* src);
+
+// On-disk format shared by both sketches, laid out like the filters': a header
+// padded to CMS_FILE_PAYLOAD_OFFSET bytes, then the counter rows in native byte
+// order.
+#define CMS_FILE_MAGIC "CMSK"
+#define CMS_FILE_VERSION 1
+#define CMS_FILE_PAYLOAD_OFFSET 4096
+#define CMS_HASH_MURMUR3_X64_128_FOLDED 1  // HashKey64
+// Sketch kinds
+#define CMS_KIND_COUNT_MIN 1
+#define CMS_KIND_COUNT_SKETCH 2
+
+typedef struct CmsFileHeader {
+    char magic[4];              // CMS_FILE_MAGIC
+    uint32_t version;           // CMS_FILE_VERSION
+    uint32_t hash_id;           // Hash function the keys were hashed with
+    uint32_t seed;              // Seed of that hash function
+    uint32_t kind;              // CMS_KIND_COUNT_MIN or CMS_KIND_COUNT_SKETCH
+    uint32_t conservative;      // Count-Min only
+    uint64_t width;
+    uint64_t depth;
+    uint64_t total;             // Two's complement for a Count-Sketch
+    uint64_t payload_offset;
+    uint64_t payload_bytes;
+    uint64_t checksum;          // Checksum64 of the payload
+} CmsFileHeader;
+
+// Return 0 on success and -1 on error
+int SaveCountMinSketch(const CountMinSketch* cms, const char* path);
+int SaveCountSketch(const CountSketch* cs, const char* path);
+// Read a saved sketch into memory. When verify is non-zero the payload
+// checksum is checked. Return NULL on error, or for a file of the other kind.
+CountMinSketch* OpenCountMinSketch(const char* path, int verify);
+CountSketch* OpenCountSketch(const char* path, int verify);
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _CMS_
@@ -0,0 +1,475 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "hll.h"
+#include "../hashing/hashing.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+// Compiled for AVX2 with a target attribute and only called when the running
+// CPU has it, so this file needs no ISA flags
+#define AVX2 __attribute__((target("avx2")))
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Keys per hashing batch
+#define HLL_BATCH 64
+// Bits of a sparse entry holding the rank
+#define HLL_RANK_BITS 6
+#define HLL_RANK_MASK ((1u << HLL_RANK_BITS) - 1)
+// Highest rank of a sparse entry: every hash bit after the sparse index is 0
+#define HLL_SPARSE_MAX_RANK (64 - HLL_SPARSE_PRECISION + 1)
+#define HLL_INITIAL_SPARSE 64
+
+static inline size_t numRegisters(const HyperLogLog* hll){
+    return (size_t)1 << hll->precision;
+}
+
+// Register bytes rounded up to whole cache lines, so the merge runs over full
+// vectors with no tail. The padding stays 0.
+static inline size_t registerBytes(int precision){
+    size_t bytes = (size_t)1 << precision;
+    return (bytes + 63) & ~(size_t)63;
+}
+
+// The sparse list never takes more bytes than the dense registers, and turns
+// dense once three quarters of that hold distinct indexes
+static inline size_t sparseLimit(const HyperLogLog* hll){
+    return numRegisters(hll) / sizeof(uint32_t);
+}
+
+static inline int maxRank(int precision){
+    return 64 - precision + 1;
+}
+
+static inline uint32_t sparseEntry(uint64_t hash){
+    uint64_t rest = hash << HLL_SPARSE_PRECISION;
+    uint32_t rank = rest == 0 ? HLL_SPARSE_MAX_RANK : (uint32_t)__builtin_clzll(rest) + 1;
+    return (uint32_t)(hash >> (64 - HLL_SPARSE_PRECISION)) << HLL_RANK_BITS | rank;
+}
+
+static inline void addDense(HyperLogLog* hll, uint64_t hash){
+    uint64_t rest = hash << hll->precision;
+    uint8_t rank = rest == 0 ? (uint8_t)maxRank(hll->precision) : (uint8_t)(__builtin_clzll(rest) + 1);
+    uint8_t* reg = &hll->registers[hash >> (64 - hll->precision)];
+    if(*reg < rank){
+        *reg = rank;
+    }
+}
+
+// The hash bits after the dense index start with the low bits of the sparse
+// index, then the bits the sparse rank was taken from
+static inline void addEntryDense(HyperLogLog* hll, uint32_t entry){
+    uint32_t index = entry >> HLL_RANK_BITS;
+    int shift = HLL_SPARSE_PRECISION - hll->precision;
+    uint32_t low = index & ((1u << shift) - 1);
+    uint8_t rank = low != 0 ? (uint8_t)(__builtin_clz(low) - (32 - shift) + 1)
+                            : (uint8_t)(shift + (entry & HLL_RANK_MASK));
+    uint8_t* reg = &hll->registers[index >> shift];
+    if(*reg < rank){
+        *reg = rank;
+    }
+}
+
+static int compareEntries(const void* a, const void* b){
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts the sparse list and keeps the highest rank of every index, which sorts
+// last among the entries of that index
+static void compactSparse(HyperLogLog* hll){
+    if(hll->sparse_sorted == hll->sparse_count){
+        return;
+    }
+    uint32_t* sparse = hll->sparse;
+    qsort(sparse, hll->sparse_count, sizeof(uint32_t), compareEntries);
+    size_t out = 0;
+    for(size_t i = 0; i < hll->sparse_count; i++){
+        if(out > 0 && (sparse[out - 1] >> HLL_RANK_BITS) == (sparse[i] >> HLL_RANK_BITS)){
+            sparse[out - 1] = sparse[i];
+        }else{
+            sparse[out++] = sparse[i];
+        }
+    }
+    hll->sparse_count = out;
+    hll->sparse_sorted = out;
+}
+
+static int toDense(HyperLogLog* hll){
+    size_t bytes = registerBytes(hll->precision);
+    uint8_t* registers = (uint8_t*)aligned_alloc(64, bytes);
+    if(registers == NULL){
+        printf("Memory Not allocated!\n");
+        return -1;
+    }
+    memset(registers, 0, bytes);
+    hll->registers = registers;
+    for(size_t i = 0; i < hll->sparse_count; i++){
+        addEntryDense(hll, hll->sparse[i]);
+    }
+    free(hll->sparse);
+    hll->sparse = NULL;
+    hll->sparse_count = 0;
+    hll->sparse_sorted = 0;
+    hll->sparse_capacity = 0;
+    return 0;
+}
+
+// Adds an entry to a sparse sketch, which may turn it dense. Returns -1 when
+// memory runs out, in which case the entry is dropped.
+static int addSparse(HyperLogLog* hll, uint32_t entry){
+    if(hll->sparse_count == hll->sparse_capacity){
+        compactSparse(hll);
+        if(hll->sparse_count > sparseLimit(hll) / 4 * 3){
+            if(toDense(hll) != 0){
+                return -1;
+            }
+            addEntryDense(hll, entry);
+            return 0;
+        }
+        // Grow when compacting freed less than half the list
+        if(hll->sparse_count > hll->sparse_capacity / 2){
+            size_t capacity = 2 * hll->sparse_capacity;
+            if(capacity > sparseLimit(hll)){
+                capacity = sparseLimit(hll);
+            }
+            uint32_t* sparse = (uint32_t*)realloc(hll->sparse, capacity * sizeof(uint32_t));
+            if(sparse == NULL){
+                printf("Memory Not allocated!\n");
+                return -1;
+            }
+            hll->sparse = sparse;
+            hll->sparse_capacity = capacity;
+        }
+    }
+    hll->sparse[hll->sparse_count++] = entry;
+    return 0;
+}
+
+static HyperLogLog* newSketch(int precision, size_t sparse_capacity){
+    if(precision < HLL_MIN_PRECISION || precision > HLL_MAX_PRECISION){
+        printf("A HyperLogLog takes a precision of %d to %d!\n", HLL_MIN_PRECISION, HLL_MAX_PRECISION);
+        return NULL;
+    }
+    HyperLogLog* hll = (HyperLogLog*)malloc(sizeof(HyperLogLog));
+    if(hll == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    hll->registers = NULL;
+    hll->sparse = (uint32_t*)malloc(sparse_capacity * sizeof(uint32_t));
+    if(hll->sparse == NULL){
+        printf("Memory Not allocated!\n");
+        free(hll);
+        return NULL;
+    }
+    hll->sparse_count = 0;
+    hll->sparse_sorted = 0;
+    hll->sparse_capacity = sparse_capacity;
+    hll->precision = precision;
+    hll->seed = HLL_SEED;
+    hll->Add = HllAdd;
+    hll->Estimate = HllEstimate;
+    return hll;
+}
+
+HyperLogLog* createHyperLogLog(int precision){
+    size_t capacity = HLL_INITIAL_SPARSE;
+    if(precision >= HLL_MIN_PRECISION && capacity > ((size_t)1 << precision) / sizeof(uint32_t)){
+        capacity = ((size_t)1 << precision) / sizeof(uint32_t);
+    }
+    return newSketch(precision, capacity);
+}
+
+void DestroyHyperLogLog(HyperLogLog* hll){
+    free(hll->registers);
+    free(hll->sparse);
+    free(hll);
+}
+
+void HllAddHash(HyperLogLog* hll, uint64_t hash){
+    if(hll->registers != NULL){
+        addDense(hll, hash);
+    }else{
+        addSparse(hll, sparseEntry(hash));
+    }
+}
+
+void HllAdd(HyperLogLog* hll, const void* str, size_t size){
+    HllAddHash(hll, HashKey64(str, size, hll->seed));
+}
+
+void HllAddBatch(HyperLogLog* hll, const void* keys, size_t key_size, size_t n){
+    const char* key = (const char*)keys;
+    uint64_t hashes[HLL_BATCH];
+    for(size_t start = 0; start < n; start += HLL_BATCH){
+        size_t count = n - start < HLL_BATCH ? n - start : HLL_BATCH;
+        HashKeys64(key + start * key_size, key_size, count, hll->seed, hashes);
+        for(size_t i = 0; i < count; i++){
+            HllAddHash(hll, hashes[i]);
+        }
+    }
+}
+
+void HllAddU64(HyperLogLog* hll, uint64_t key){
+    HllAddHash(hll, HashU64(key, hll->seed));
+}
+
+//-----------------------------------------------------------------------------
+// Estimation
+
+// sigma and tau of Ertl's improved estimator, which correct for registers that
+// are still 0 and registers at the highest rank
+static double sigma(double x){
+    if(x == 1){
+        return INFINITY;
+    }
+    double y = 1, z = x, previous;
+    do{
+        x *= x;
+        previous = z;
+        z += x * y;
+        y += y;
+    }while(z != previous);
+    return z;
+}
+
+static double tau(double x){
+    if(x == 0 || x == 1){
+        return 0;
+    }
+    double y = 1, z = 1 - x, previous;
+    do{
+        x = sqrt(x);
+        previous = z;
+        y *= 0.5;
+        z -= (1 - x) * (1 - x) * y;
+    }while(z != previous);
+    return z / 3;
+}
+
+static double estimateDense(const HyperLogLog* hll){
+    uint32_t histogram[64 + 2] = {0};
+    size_t m = numRegisters(hll);
+    for(size_t i = 0; i < m; i++){
+        histogram[hll->registers[i]]++;
+    }
+    int q = 64 - hll->precision;
+    double z = m * tau(1 - (double)histogram[q + 1] / m);
+    for(int k = q; k >= 1; k--){
+        z = 0.5 * (z + histogram[k]);
+    }
+    z += m * sigma((double)histogram[0] / m);
+    return m / (2 * log(2)) * m / z;
+}
+
+// Linear counting over the 2^HLL_SPARSE_PRECISION sparse indexes, which the
+// list never fills more than a fraction of
+static double estimateSparse(HyperLogLog* hll){
+    compactSparse(hll);
+    double m = (double)(1u << HLL_SPARSE_PRECISION);
+    return m * log(m / (m - (double)hll->sparse_count));
+}
+
+double HllEstimate(HyperLogLog* hll){
+    return hll->registers != NULL ? estimateDense(hll) : estimateSparse(hll);
+}
+
+int HllIsSparse(const HyperLogLog* hll){
+    return hll->registers == NULL;
+}
+
+uint64_t HllSizeInBytes(const HyperLogLog* hll){
+    if(hll->registers != NULL){
+        return registerBytes(hll->precision);
+    }
+    return hll->sparse_capacity * sizeof(uint32_t);
+}
+
+//-----------------------------------------------------------------------------
+// Merging
+
+#if defined(__x86_64__)
+AVX2 static void maxRegistersAvx2(uint8_t* dst, const uint8_t* src, size_t bytes){
+    for(size_t i = 0; i < bytes; i += 32){
+        __m256i v = _mm256_max_epu8(_mm256_load_si256((const __m256i*)(dst + i)),
+                                    _mm256_load_si256((const __m256i*)(src + i)));
+        _mm256_store_si256((__m256i*)(dst + i), v);
+    }
+}
+#endif
+
+// Register-wise max over bytes, a multiple of 64
+static void maxRegisters(uint8_t* dst, const uint8_t* src, size_t bytes){
+#if defined(__x86_64__)
+    if(__builtin_cpu_supports("avx2")){
+        maxRegistersAvx2(dst, src, bytes);
+        return;
+    }
+    for(size_t i = 0; i < bytes; i += 16){
+        __m128i v = _mm_max_epu8(_mm_load_si128((const __m128i*)(dst + i)),
+                                 _mm_load_si128((const __m128i*)(src + i)));
+        _mm_store_si128((__m128i*)(dst + i), v);
+    }
+#elif defined(__ARM_NEON)
+    for(size_t i = 0; i < bytes; i += 16){
+        vst1q_u8(dst + i, vmaxq_u8(vld1q_u8(dst + i), vld1q_u8(src + i)));
+    }
+#else
+    for(size_t i = 0; i < bytes; i++){
+        dst[i] = dst[i] > src[i] ? dst[i] : src[i];
+    }
+#endif
+}
+
+int HllMerge(HyperLogLog* dst, HyperLogLog* src){
+    if(dst->precision != src->precision || dst->seed != src->seed){
+        printf("Only sketches of the same precision and seed can be merged!\n");
+        return -1;
+    }
+    if(dst == src){
+        return 0;
+    }
+    if(src->registers == NULL){
+        for(size_t i = 0; i < src->sparse_count; i++){
+            if(dst->registers != NULL){
+                addEntryDense(dst, src->sparse[i]);
+            }else if(addSparse(dst, src->sparse[i]) != 0){
+                return -1;
+            }
+        }
+        return 0;
+    }
+    if(dst->registers == NULL && toDense(dst) != 0){
+        return -1;
+    }
+    maxRegisters(dst->registers, src->registers, registerBytes(dst->precision));
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Files
+
+int SaveHyperLogLog(HyperLogLog* hll, const char* path){
+    const void* payload;
+    uint64_t bytes;
+    if(hll->registers != NULL){
+        payload = hll->registers;
+        bytes = numRegisters(hll);
+    }else{
+        compactSparse(hll);
+        payload = hll->sparse;
+        bytes = hll->sparse_count * sizeof(uint32_t);
+    }
+    HllFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HLL_FILE_MAGIC, sizeof(header.magic));
+    header.version = HLL_FILE_VERSION;
+    header.hash_id = HLL_HASH_MURMUR3_X64_128_FOLDED;
+    header.seed = hll->seed;
+    header.precision = hll->precision;
+    header.sparse = hll->registers == NULL;
+    header.payload_offset = HLL_FILE_PAYLOAD_OFFSET;
+    header.payload_bytes = bytes;
+    header.checksum = Checksum64(CHECKSUM64_BASIS, payload, bytes);
+
+    FILE* file = fopen(path, "wb");
+    if(file == NULL){
+        printf("Could not open %s for writing!\n", path);
+        return -1;
+    }
+    char padding[HLL_FILE_PAYLOAD_OFFSET] = {0};
+    memcpy(padding, &header, sizeof(header));
+    int ok = fwrite(padding, 1, sizeof(padding), file) == sizeof(padding) &&
+             fwrite(payload, 1, bytes, file) == bytes;
+    ok = (fclose(file) == 0) && ok;
+    if(!ok){
+        printf("Could not write %s!\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+// Ranks out of range would index past the estimator's histogram
+static int validPayload(const HyperLogLog* hll){
+    if(hll->registers != NULL){
+        for(size_t i = 0; i < numRegisters(hll); i++){
+            if(hll->registers[i] > maxRank(hll->precision)){
+                return 0;
+            }
+        }
+        return 1;
+    }
+    for(size_t i = 0; i < hll->sparse_count; i++){
+        uint32_t rank = hll->sparse[i] & HLL_RANK_MASK;
+        if(rank == 0 || rank > HLL_SPARSE_MAX_RANK ||
+           hll->sparse[i] >> HLL_RANK_BITS >= 1u << HLL_SPARSE_PRECISION){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+HyperLogLog* OpenHyperLogLog(const char* path, int verify){
+    FILE* file = fopen(path, "rb");
+    if(file == NULL){
+        printf("Could not open %s!\n", path);
+        return NULL;
+    }
+    HllFileHeader header;
+    if(fread(&header, sizeof(header), 1, file) != 1 ||
+       memcmp(header.magic, HLL_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+       header.version != HLL_FILE_VERSION ||
+       header.hash_id != HLL_HASH_MURMUR3_X64_128_FOLDED ||
+       header.seed != HLL_SEED ||
+       header.precision < HLL_MIN_PRECISION || header.precision > HLL_MAX_PRECISION ||
+       header.sparse > 1 ||
+       header.payload_offset != HLL_FILE_PAYLOAD_OFFSET ||
+       (header.sparse ? header.payload_bytes % sizeof(uint32_t) != 0 ||
+                        header.payload_bytes > sizeof(uint32_t) << HLL_SPARSE_PRECISION
+                      : header.payload_bytes != 1ULL << header.precision)){
+        printf("%s is not a HyperLogLog file!\n", path);
+        fclose(file);
+        return NULL;
+    }
+    size_t count = header.payload_bytes / sizeof(uint32_t);
+    HyperLogLog* hll = newSketch((int)header.precision, count > HLL_INITIAL_SPARSE ? count : HLL_INITIAL_SPARSE);
+    if(hll == NULL){
+        fclose(file);
+        return NULL;
+    }
+    void* payload = hll->sparse;
+    if(!header.sparse){
+        if(toDense(hll) != 0){
+            fclose(file);
+            DestroyHyperLogLog(hll);
+            return NULL;
+        }
+        payload = hll->registers;
+    }
+    int ok = fseek(file, (long)header.payload_offset, SEEK_SET) == 0 &&
+             fread(payload, 1, header.payload_bytes, file) == header.payload_bytes;
+    fclose(file);
+    if(!ok){
+        printf("Could not read %s!\n", path);
+        DestroyHyperLogLog(hll);
+        return NULL;
+    }
+    if(header.sparse){
+        hll->sparse_count = count;
+    }
+    if(verify && Checksum64(CHECKSUM64_BASIS, payload, header.payload_bytes) != header.checksum){
+        printf("%s failed its checksum!\n", path);
+        DestroyHyperLogLog(hll);
+        return NULL;
+    }
+    if(!validPayload(hll)){
+        printf("%s is not a HyperLogLog file!\n", path);
+        DestroyHyperLogLog(hll);
+        return NULL;
+    }
+    return hll;
+}
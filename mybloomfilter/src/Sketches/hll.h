@@ -0,0 +1,102 @@
+#ifndef _HLL_
+#define _HLL_
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//-----------------------------------------------------------------------------
+
+// HyperLogLog++ distinct counter. A sketch of precision p has 2^p one-byte
+// registers, for a relative error of about 1.04 / sqrt(2^p): 0.8% at p = 14
+// in 16 KB.
+//
+// As in HLL++ the hash is 64 bits, so no large-range correction is needed, and
+// a new sketch starts sparse: it keeps a list of (index, rank) pairs at
+// precision HLL_SPARSE_PRECISION and counts them by linear counting, which is
+// exact in practice for small sets and takes a fraction of the dense size. The
+// list turns into dense registers once it would outgrow them. Dense sketches
+// are estimated with Ertl's improved estimator over the register histogram
+// ("New cardinality estimation algorithms for HyperLogLog sketches", 2017),
+// which is unbiased over the whole range without HLL++'s empirical bias tables.
+//
+// Keys are hashed with HashKey64 under HLL_SEED, the split block filter's
+// default seed, so a hash taken once with SbbfHashKey (or SbbfHashU64 for
+// HllAddU64) can go to both the filter and HllAddHash.
+
+#define HLL_MIN_PRECISION 4
+#define HLL_MAX_PRECISION 18
+#define HLL_SPARSE_PRECISION 25
+#define HLL_SEED 0xfeedba
+
+typedef struct HyperLogLog {
+    uint8_t *registers;        // 2^precision ranks, 64-byte aligned; NULL while sparse
+    uint32_t *sparse;          // Index at HLL_SPARSE_PRECISION above a 6-bit rank
+    size_t sparse_count;
+    size_t sparse_sorted;      // Leading entries that are sorted and deduplicated
+    size_t sparse_capacity;
+    int precision;
+    uint32_t seed;             // Seed of the key hash
+    void (*Add)(struct HyperLogLog* hll, const void* str, size_t size);
+    double (*Estimate)(struct HyperLogLog* hll);
+} HyperLogLog;
+
+// precision is HLL_MIN_PRECISION to HLL_MAX_PRECISION
+HyperLogLog* createHyperLogLog(int precision);
+void DestroyHyperLogLog(HyperLogLog* hll);
+void HllAdd(HyperLogLog* hll, const void* str, size_t size);
+// Adds a key by its HashKey64 under hll->seed
+void HllAddHash(HyperLogLog* hll, uint64_t hash);
+// Adds n fixed-size keys stored back to back in keys, hashed a batch at a time
+void HllAddBatch(HyperLogLog* hll, const void* keys, size_t key_size, size_t n);
+// Fast path for 64-bit integer keys, hashed with HashU64. A key added here
+// counts as a different key from the same 8 bytes passed to HllAdd.
+void HllAddU64(HyperLogLog* hll, uint64_t key);
+// Estimated number of distinct keys added. Sorts the sparse list first.
+double HllEstimate(HyperLogLog* hll);
+int HllIsSparse(const HyperLogLog* hll);
+uint64_t HllSizeInBytes(const HyperLogLog* hll);
+// Makes dst count the keys of both sketches. They must have the same precision
+// and seed; returns 0 on success and -1 otherwise. Dense registers are merged
+// with a vector max, with AVX2 when the running CPU has it.
+int HllMerge(HyperLogLog* dst, HyperLogLog* src);
+
+// On-disk format: a header padded to HLL_FILE_PAYLOAD_OFFSET bytes, then the
+// dense registers or the sorted sparse list in native byte order. Sketches are
+// small and read whole, so the header is padded to a cache line, not a page.
+#define HLL_FILE_MAGIC "HLL+"
+#define HLL_FILE_VERSION 1
+#define HLL_FILE_PAYLOAD_OFFSET 64
+#define HLL_HASH_MURMUR3_X64_128_FOLDED 1  // HashKey64
+
+typedef struct HllFileHeader {
+    char magic[4];              // HLL_FILE_MAGIC
+    uint32_t version;           // HLL_FILE_VERSION
+    uint32_t hash_id;           // Hash function the keys were hashed with
+    uint32_t seed;              // Seed of that hash function
+    uint32_t precision;
+    uint32_t sparse;            // 1 when the payload is the sparse list
+    uint64_t payload_offset;
+    uint64_t payload_bytes;
+    uint64_t checksum;          // Checksum64 of the payload
+} HllFileHeader;
+
+// Returns 0 on success and -1 on error. Sorts the sparse list first.
+int SaveHyperLogLog(HyperLogLog* hll, const char* path);
+// Reads a saved sketch into memory, where it can keep counting and be merged.
+// When verify is non-zero the payload checksum is checked. Returns NULL on error.
+HyperLogLog* OpenHyperLogLog(const char* path, int verify);
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HLL_
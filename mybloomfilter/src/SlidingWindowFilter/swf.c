@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "filter/block.h"
+#include "swf.h"
+#include "../hashing/hashing.h"
+#include "../SplitBlockBloomFilter/kernels/sbbf_kernels.h"
+
+#define SWF_BATCH 64
+
+SlidingWindowFilter* createSlidingWindowFilter(long int slice_ndv, double fpp, int num_slices){
+    if(num_slices < 1 || num_slices > SWF_MAX_SLICES){
+        printf("A sliding window filter takes 1 to %d slices!\n", SWF_MAX_SLICES);
+        return NULL;
+    }
+    SlidingWindowFilter* bf = (SlidingWindowFilter*)malloc(sizeof(SlidingWindowFilter));
+    if(bf == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    bf->slice_ndv = slice_ndv > 0 ? slice_ndv : 1;
+    bf->fpp = fpp;
+    // Same size for every slice, so a hash picks the same bucket in each
+    uint64_t bytes = libfilter_block_bytes_needed(bf->slice_ndv, fpp / num_slices);
+    for(int i = 0; i < num_slices; i++){
+        if(libfilter_block_init(bytes, &bf->slices[i])){
+            printf("Memory Not allocated!\n");
+            for(int j = 0; j < i; j++){
+                libfilter_block_destruct(&bf->slices[j]);
+            }
+            free(bf);
+            return NULL;
+        }
+        bf->count[i] = 0;
+    }
+    bf->num_slices = num_slices;
+    bf->current = 0;
+    bf->slice = 0;
+    bf->seed = 0x5117de;
+    bf->kernel = SbbfSelectKernel();
+    bf->Insert = SlidingInsert;
+    bf->CheckKey = SlidingCheckKey;
+    return bf;
+}
+
+void DestroySlidingWindowFilter(SlidingWindowFilter* bf){
+    for(int i = 0; i < bf->num_slices; i++){
+        libfilter_block_destruct(&bf->slices[i]);
+    }
+    free(bf);
+}
+
+void SlidingInsert(SlidingWindowFilter* bf, const void* str, size_t size){
+    bf->kernel->AddHash(HashKey64(str, size, bf->seed), &bf->slices[bf->current]);
+    bf->count[bf->current]++;
+}
+
+int SlidingCheckKey(SlidingWindowFilter* bf, const void* str, size_t size){
+    uint64_t hash = HashKey64(str, size, bf->seed);
+    return !bf->kernel->FindBatchAny(&hash, 1, bf->slices, bf->num_slices);
+}
+
+void SlidingInsertBatch(SlidingWindowFilter* bf, const void* keys, size_t key_size, size_t n){
+    const char* key = (const char*)keys;
+    uint64_t hashes[SWF_BATCH];
+    for(size_t start = 0; start < n; start += SWF_BATCH){
+        size_t count = n - start < SWF_BATCH ? n - start : SWF_BATCH;
+        HashKeys64(key + start * key_size, key_size, count, bf->seed, hashes);
+        bf->kernel->AddBatch(hashes, count, &bf->slices[bf->current]);
+    }
+    bf->count[bf->current] += n;
+}
+
+void SlidingCheckKeyBatch(SlidingWindowFilter* bf, const void* keys, size_t key_size, size_t n, uint64_t* result){
+    const char* key = (const char*)keys;
+    uint64_t hashes[SWF_BATCH];
+    for(size_t start = 0; start < n; start += SWF_BATCH){
+        size_t count = n - start < SWF_BATCH ? n - start : SWF_BATCH;
+        HashKeys64(key + start * key_size, key_size, count, bf->seed, hashes);
+        result[start / SWF_BATCH] = bf->kernel->FindBatchAny(hashes, count, bf->slices, bf->num_slices);
+    }
+}
+
+void SlidingInsertU64(SlidingWindowFilter* bf, uint64_t key){
+    bf->kernel->AddHash(HashU64(key, bf->seed), &bf->slices[bf->current]);
+    bf->count[bf->current]++;
+}
+
+int SlidingCheckKeyU64(SlidingWindowFilter* bf, uint64_t key){
+    uint64_t hash = HashU64(key, bf->seed);
+    return !bf->kernel->FindBatchAny(&hash, 1, bf->slices, bf->num_slices);
+}
+
+void SlidingInsertU64Batch(SlidingWindowFilter* bf, const uint64_t* keys, size_t n){
+    uint64_t hashes[SWF_BATCH];
+    for(size_t start = 0; start < n; start += SWF_BATCH){
+        size_t count = n - start < SWF_BATCH ? n - start : SWF_BATCH;
+        HashKeysU64(keys + start, count, bf->seed, hashes);
+        bf->kernel->AddBatch(hashes, count, &bf->slices[bf->current]);
+    }
+    bf->count[bf->current] += n;
+}
+
+void SlidingCheckKeyU64Batch(SlidingWindowFilter* bf, const uint64_t* keys, size_t n, uint64_t* result){
+    uint64_t hashes[SWF_BATCH];
+    for(size_t start = 0; start < n; start += SWF_BATCH){
+        size_t count = n - start < SWF_BATCH ? n - start : SWF_BATCH;
+        HashKeysU64(keys + start, count, bf->seed, hashes);
+        result[start / SWF_BATCH] = bf->kernel->FindBatchAny(hashes, count, bf->slices, bf->num_slices);
+    }
+}
+
+void SlidingAdvance(SlidingWindowFilter* bf){
+    bf->current = (bf->current + 1) % bf->num_slices;
+    // A slice nothing went into since it was cleared needs no clearing. The
+    // bits are cleared in place: libfilter_block_zero_out resets the struct to
+    // an empty filter and drops the bucket array rather than zeroing it.
+    libfilter_block* slice = &bf->slices[bf->current];
+    if(bf->count[bf->current] > 0){
+        memset(slice->block_.block, 0, libfilter_block_size_in_bytes(slice));
+        bf->count[bf->current] = 0;
+    }
+    bf->slice++;
+}
+
+void SlidingAdvanceTo(SlidingWindowFilter* bf, uint64_t slice){
+    if(slice <= bf->slice){
+        return;
+    }
+    uint64_t steps = slice - bf->slice;
+    if(steps > (uint64_t)bf->num_slices){
+        steps = bf->num_slices;
+    }
+    for(uint64_t i = 0; i < steps; i++){
+        SlidingAdvance(bf);
+    }
+    bf->slice = slice;
+}
+
+uint64_t SlidingSizeInBytes(const SlidingWindowFilter* bf){
+    return bf->num_slices * libfilter_block_size_in_bytes(&bf->slices[0]);
+}
+
+double SlidingFpp(const SlidingWindowFilter* bf){
+    // A key is a false positive unless every slice rejects it
+    double miss = 1;
+    for(int i = 0; i < bf->num_slices; i++){
+        miss *= 1 - libfilter_block_fpp(bf->count[i], libfilter_block_size_in_bytes(&bf->slices[i]));
+    }
+    return 1 - miss;
+}
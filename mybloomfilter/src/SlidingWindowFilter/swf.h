@@ -0,0 +1,78 @@
+#ifndef _SWF_
+#define _SWF_
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include "filter/block.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//-----------------------------------------------------------------------------
+
+// A split block filter over a sliding window of time, for deduplicating a
+// stream over its last few minutes. The window is num_slices slices of equal
+// size: keys go into the current slice, lookups check all of them, and
+// advancing to the next slice clears the oldest one and reuses it, so memory
+// stays fixed and the window never has to be rebuilt.
+//
+// Each slice is sized for slice_ndv keys at fpp / num_slices, which keeps the
+// FPP across the whole window below fpp. Because the slices have the same
+// bucket count a key lands in the same bucket of every slice, and a lookup
+// tests all of them with one bucket index and mask.
+
+#define SWF_MAX_SLICES 64
+
+typedef struct SlidingWindowFilter {
+    libfilter_block slices[SWF_MAX_SLICES];
+    uint64_t count[SWF_MAX_SLICES];       // Keys inserted into slice i since it was cleared
+    const struct SbbfKernel *kernel;      // SIMD bucket kernel chosen for this CPU
+    int num_slices;
+    int current;                          // Slice taking inserts
+    uint64_t slice;                       // Number of the current time slice
+    uint64_t slice_ndv;                   // Keys each slice was sized for
+    double fpp;                           // Target false positive probability over the window
+    uint32_t seed;                        // Seed of the key hash
+    void (*Insert)(struct SlidingWindowFilter* bf, const void* str, size_t size);
+    int (*CheckKey)(struct SlidingWindowFilter* bf, const void* str, size_t size);
+} SlidingWindowFilter;
+
+// num_slices is 1 to SWF_MAX_SLICES; the window covers that many time slices
+SlidingWindowFilter* createSlidingWindowFilter(long int slice_ndv, double fpp, int num_slices);
+void DestroySlidingWindowFilter(SlidingWindowFilter* bf);
+void SlidingInsert(SlidingWindowFilter* bf, const void* str, size_t size);
+// Returns 0 when the key may be in the window and 1 when it is definitely absent
+int SlidingCheckKey(SlidingWindowFilter* bf, const void* str, size_t size);
+// Batch forms over n fixed-size keys stored back to back, as InsertBatch and
+// CheckKeyBatch of the split block filter
+void SlidingInsertBatch(SlidingWindowFilter* bf, const void* keys, size_t key_size, size_t n);
+void SlidingCheckKeyBatch(SlidingWindowFilter* bf, const void* keys, size_t key_size, size_t n, uint64_t* result);
+// Fast path for 64-bit integer keys, as InsertU64 and CheckKeyU64 of the split
+// block filter
+void SlidingInsertU64(SlidingWindowFilter* bf, uint64_t key);
+int SlidingCheckKeyU64(SlidingWindowFilter* bf, uint64_t key);
+void SlidingInsertU64Batch(SlidingWindowFilter* bf, const uint64_t* keys, size_t n);
+void SlidingCheckKeyU64Batch(SlidingWindowFilter* bf, const uint64_t* keys, size_t n, uint64_t* result);
+// Starts a new time slice, dropping the keys of the oldest one
+void SlidingAdvance(SlidingWindowFilter* bf);
+// Moves the window so that slice is the current slice, e.g. with slice set to
+// the current time divided by the slice length. Slices that passed without a
+// call are dropped too, so a gap longer than the window empties it. A slice
+// number at or before the current one is ignored. Slices start at 0.
+void SlidingAdvanceTo(SlidingWindowFilter* bf, uint64_t slice);
+// Bytes of all slices
+uint64_t SlidingSizeInBytes(const SlidingWindowFilter* bf);
+// Expected FPP over the keys currently in the window
+double SlidingFpp(const SlidingWindowFilter* bf);
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _SWF_
@@ -0,0 +1,60 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sbbf_kernels.h"
+
+#if defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+static int supported(const SbbfKernel* kernel){
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+#if defined(SBBF_HAVE_AVX512)
+    if(kernel == &sbbf_kernel_avx512){
+        return __builtin_cpu_supports("avx512f");
+    }
+#endif
+    if(kernel == &sbbf_kernel_avx2){
+        return __builtin_cpu_supports("avx2");
+    }
+    if(kernel == &sbbf_kernel_sse41){
+        return __builtin_cpu_supports("sse4.1");
+    }
+#elif defined(__aarch64__)
+    if(kernel == &sbbf_kernel_neon){
+        return (getauxval(AT_HWCAP) & HWCAP_ASIMD) != 0;
+    }
+#endif
+    return kernel == &sbbf_kernel_scalar;
+}
+
+const SbbfKernel* SbbfSelectKernel(void){
+    // Widest first
+    static const SbbfKernel* const kernels[] = {
+#if defined(__x86_64__)
+#if defined(SBBF_HAVE_AVX512)
+        &sbbf_kernel_avx512,
+#endif
+        &sbbf_kernel_avx2, &sbbf_kernel_sse41,
+#elif defined(__aarch64__)
+        &sbbf_kernel_neon,
+#endif
+        &sbbf_kernel_scalar};
+    const int count = sizeof(kernels) / sizeof(kernels[0]);
+
+    const char* wanted = getenv("SBBF_KERNEL");
+    if(wanted != NULL){
+        for(int i = 0; i < count; i++){
+            if(strcmp(kernels[i]->name, wanted) == 0 && supported(kernels[i])){
+                return kernels[i];
+            }
+        }
+    }
+    for(int i = 0; i < count; i++){
+        if(supported(kernels[i])){
+            return kernels[i];
+        }
+    }
+    return &sbbf_kernel_scalar;
+}
@@ -0,0 +1,16 @@
+// Built with -mavx2, which switches filter/block.h to its AVX2 bucket code.
+#include "sbbf_kernels.h"
+
+static void addHash(uint64_t hash, libfilter_block* filter){
+    libfilter_block_simd_add_hash(hash, filter);
+}
+
+static bool findHash(uint64_t hash, const libfilter_block* filter){
+    return libfilter_block_simd_find_hash(hash, filter);
+}
+
+#include "sbbf_kernel_batch.h"
+
+const SbbfKernel sbbf_kernel_avx2 = {"avx2", addHash, findHash, addBatch, findBatch,
+                                         findBatchAny, orBuckets, andBuckets,
+                                         countBuckets};
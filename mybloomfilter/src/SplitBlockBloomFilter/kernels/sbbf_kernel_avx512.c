@@ -0,0 +1,50 @@
+// Built with -mavx512f. Single-hash operations use the AVX2 code from
+// filter/block.h; batch lookups test two 256-bit buckets per 512-bit instruction.
+#include <immintrin.h>
+#include "sbbf_kernels.h"
+
+static void addHash(uint64_t hash, libfilter_block* filter){
+    libfilter_block_simd_add_hash(hash, filter);
+}
+
+static bool findHash(uint64_t hash, const libfilter_block* filter){
+    return libfilter_block_simd_find_hash(hash, filter);
+}
+
+#define SBBF_KERNEL_CUSTOM_FIND_BATCH
+#include "sbbf_kernel_batch.h"
+
+static uint64_t findBatch(const uint64_t* hashes, size_t count, const libfilter_block* filter){
+    for(size_t i = 0; i < count; i++){
+        prefetchBucket(hashes[i], filter);
+    }
+    const __m512i seeds = _mm512_setr_epi32(
+        0x44974d91, 0x47b6137b, 0xa2b7289d, 0x8824ad5b,
+        0x2df1424b, 0x705495c7, 0x5c6bfb31, 0x9efc4947,
+        0x44974d91, 0x47b6137b, 0xa2b7289d, 0x8824ad5b,
+        0x2df1424b, 0x705495c7, 0x5c6bfb31, 0x9efc4947);
+    const __m512i ones = _mm512_set1_epi32(1);
+    uint64_t found = 0;
+    size_t i = 0;
+    for(; i + 2 <= count; i += 2){
+        // Low half of every vector belongs to hashes[i], high half to hashes[i + 1]
+        __m512i h = _mm512_inserti64x4(_mm512_set1_epi32((uint32_t)hashes[i]),
+                                       _mm256_set1_epi32((uint32_t)hashes[i + 1]), 1);
+        __m512i mask = _mm512_sllv_epi32(ones, _mm512_srli_epi32(_mm512_mullo_epi32(h, seeds), 32 - 5));
+        __m512i buckets = _mm512_inserti64x4(
+            _mm512_castsi256_si512(_mm256_load_si256((const __m256i*)bucketOf(hashes[i], filter))),
+            _mm256_load_si256((const __m256i*)bucketOf(hashes[i + 1], filter)), 1);
+        __m512i missing = _mm512_andnot_si512(buckets, mask);
+        __mmask16 lanes = _mm512_test_epi32_mask(missing, missing);
+        found |= (uint64_t)((lanes & 0xff) == 0) << i;
+        found |= (uint64_t)((lanes >> 8) == 0) << (i + 1);
+    }
+    if(i < count){
+        found |= (uint64_t)findHash(hashes[i], filter) << i;
+    }
+    return found;
+}
+
+const SbbfKernel sbbf_kernel_avx512 = {"avx512", addHash, findHash, addBatch, findBatch,
+                                         findBatchAny, orBuckets, andBuckets,
+                                         countBuckets};
@@ -0,0 +1,203 @@
+// Generic prefetching batch loops and whole-array merges shared by the kernels.
+// The including file defines static addHash/findHash for its instruction set
+// first, and SBBF_KERNEL_CUSTOM_FIND_BATCH when it brings its own findBatch.
+
+#ifndef _SBBF_KERNEL_BATCH_
+#define _SBBF_KERNEL_BATCH_
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+static inline const char* bucketOf(uint64_t hash, const libfilter_block* filter){
+    return (const char*)filter->block_.block +
+        libfilter_block_index(hash, filter->num_buckets_) * (8 * sizeof(uint32_t));
+}
+
+static inline void prefetchBucket(uint64_t hash, const libfilter_block* filter){
+#if defined(__x86_64__)
+    _mm_prefetch(bucketOf(hash, filter), _MM_HINT_T0);
+#else
+    __builtin_prefetch(bucketOf(hash, filter));
+#endif
+}
+
+static void addBatch(const uint64_t* hashes, size_t count, libfilter_block* filter){
+    for(size_t i = 0; i < count; i++){
+        prefetchBucket(hashes[i], filter);
+    }
+    for(size_t i = 0; i < count; i++){
+        addHash(hashes[i], filter);
+    }
+}
+
+#if !defined(SBBF_KERNEL_CUSTOM_FIND_BATCH)
+static uint64_t findBatch(const uint64_t* hashes, size_t count, const libfilter_block* filter){
+    for(size_t i = 0; i < count; i++){
+        prefetchBucket(hashes[i], filter);
+    }
+    uint64_t found = 0;
+    for(size_t i = 0; i < count; i++){
+        found |= (uint64_t)findHash(hashes[i], filter) << i;
+    }
+    return found;
+}
+#endif
+
+static uint64_t findBatchAny(const uint64_t* hashes, size_t count, const libfilter_block* filters,
+                             size_t num_filters){
+    for(size_t i = 0; i < count; i++){
+        for(size_t f = 0; f < num_filters; f++){
+            prefetchBucket(hashes[i], &filters[f]);
+        }
+    }
+    uint64_t found = 0;
+    for(size_t i = 0; i < count; i++){
+        size_t offset = libfilter_block_index(hashes[i], filters[0].num_buckets_) * (8 * sizeof(uint32_t));
+#if defined(__AVX2__)
+        const __m256i mask = libfilter_block_simd_make_mask(hashes[i]);
+        for(size_t f = 0; f < num_filters; f++){
+            if(_mm256_testc_si256(_mm256_load_si256((const __m256i*)((const char*)filters[f].block_.block + offset)), mask)){
+                found |= 1ULL << i;
+                break;
+            }
+        }
+#else
+        const libfilter_block_scalar_bucket mask = libfilter_block_scalar_make_mask(hashes[i]);
+        for(size_t f = 0; f < num_filters; f++){
+            const uint32_t* bucket = (const uint32_t*)((const char*)filters[f].block_.block + offset);
+            uint32_t missing = 0;
+            for(int j = 0; j < 8; j++){
+                missing |= mask.payload[j] & ~bucket[j];
+            }
+            if(missing == 0){
+                found |= 1ULL << i;
+                break;
+            }
+        }
+#endif
+    }
+    return found;
+}
+
+// Vector type of the whole-array merges. Buckets are 32 bytes and the arrays
+// are 32-byte aligned, so every step up to AVX2 is a full aligned vector.
+// AVX-512 covers two buckets with unaligned loads and stores, since an array
+// from libfilter_block_init need not be 64-byte aligned, and finishes an odd
+// count with one AVX2 step.
+#if defined(__AVX512F__)
+typedef __m512i MergeVec;
+#define MERGE_WORDS 16
+#define mergeLoad(p) _mm512_loadu_si512((const void*)(p))
+#define mergeStore(p, v) _mm512_storeu_si512((void*)(p), v)
+#define mergeOr _mm512_or_si512
+#define mergeAnd _mm512_and_si512
+#elif defined(__AVX2__)
+typedef __m256i MergeVec;
+#define MERGE_WORDS 8
+#define mergeLoad(p) _mm256_load_si256((const __m256i*)(p))
+#define mergeStore(p, v) _mm256_store_si256((__m256i*)(p), v)
+#define mergeOr _mm256_or_si256
+#define mergeAnd _mm256_and_si256
+#elif defined(__SSE4_1__)
+typedef __m128i MergeVec;
+#define MERGE_WORDS 4
+#define mergeLoad(p) _mm_load_si128((const __m128i*)(p))
+#define mergeStore(p, v) _mm_store_si128((__m128i*)(p), v)
+#define mergeOr _mm_or_si128
+#define mergeAnd _mm_and_si128
+#elif defined(__ARM_NEON)
+typedef uint32x4_t MergeVec;
+#define MERGE_WORDS 4
+#define mergeLoad(p) vld1q_u32(p)
+#define mergeStore(p, v) vst1q_u32(p, v)
+#define mergeOr vorrq_u32
+#define mergeAnd vandq_u32
+#else
+typedef uint32_t MergeVec;
+#define MERGE_WORDS 1
+#define mergeLoad(p) (*(p))
+#define mergeStore(p, v) (*(p) = (v))
+#define mergeOr(a, b) ((a) | (b))
+#define mergeAnd(a, b) ((a) & (b))
+#endif
+
+static void orBuckets(uint32_t* dst, const uint32_t* src, size_t num_buckets){
+    size_t words = 8 * num_buckets, i = 0;
+    for(; i + MERGE_WORDS <= words; i += MERGE_WORDS){
+        MergeVec v = mergeOr(mergeLoad(dst + i), mergeLoad(src + i));
+        mergeStore(dst + i, v);
+    }
+#if defined(__AVX512F__)
+    if(i < words){
+        __m256i* d = (__m256i*)(dst + i);
+        _mm256_store_si256(d, _mm256_or_si256(_mm256_load_si256(d), _mm256_load_si256((const __m256i*)(src + i))));
+    }
+#endif
+}
+
+static void andBuckets(uint32_t* dst, const uint32_t* src, size_t num_buckets){
+    size_t words = 8 * num_buckets, i = 0;
+    for(; i + MERGE_WORDS <= words; i += MERGE_WORDS){
+        MergeVec v = mergeAnd(mergeLoad(dst + i), mergeLoad(src + i));
+        mergeStore(dst + i, v);
+    }
+#if defined(__AVX512F__)
+    if(i < words){
+        __m256i* d = (__m256i*)(dst + i);
+        _mm256_store_si256(d, _mm256_and_si256(_mm256_load_si256(d), _mm256_load_si256((const __m256i*)(src + i))));
+    }
+#endif
+}
+
+// Bits set in one 32-byte bucket. x86 counts the nibbles of every byte with a
+// byte shuffle and sums the bytes with SAD; NEON has a byte popcount.
+static inline unsigned bucketBits(const uint32_t* bucket){
+#if defined(__AVX2__)
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    __m256i v = _mm256_load_si256((const __m256i*)bucket);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(table, _mm256_and_si256(v, low)),
+                                    _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), low)));
+    __m256i sums = _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+    __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    return (unsigned)(_mm_cvtsi128_si64(half) + _mm_extract_epi64(half, 1));
+#elif defined(__SSE4_1__)
+    const __m128i table = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m128i low = _mm_set1_epi8(0x0f);
+    __m128i sums = _mm_setzero_si128();
+    for(int i = 0; i < 8; i += 4){
+        __m128i v = _mm_load_si128((const __m128i*)(bucket + i));
+        __m128i bytes = _mm_add_epi8(_mm_shuffle_epi8(table, _mm_and_si128(v, low)),
+                                     _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(v, 4), low)));
+        sums = _mm_add_epi64(sums, _mm_sad_epu8(bytes, _mm_setzero_si128()));
+    }
+    return (unsigned)(_mm_cvtsi128_si64(sums) + _mm_extract_epi64(sums, 1));
+#elif defined(__ARM_NEON)
+    const uint8_t* bytes = (const uint8_t*)bucket;
+    return vaddlvq_u8(vcntq_u8(vld1q_u8(bytes))) + vaddlvq_u8(vcntq_u8(vld1q_u8(bytes + 16)));
+#else
+    unsigned bits = 0;
+    for(int i = 0; i < 8; i++){
+        bits += __builtin_popcount(bucket[i]);
+    }
+    return bits;
+#endif
+}
+
+static void countBuckets(const uint32_t* buckets, size_t num_buckets, uint64_t* histogram){
+    for(size_t i = 0; i < num_buckets; i++){
+        histogram[bucketBits(buckets + 8 * i)]++;
+    }
+}
+
+#undef MERGE_WORDS
+#undef mergeLoad
+#undef mergeStore
+#undef mergeOr
+#undef mergeAnd
+
+#endif // _SBBF_KERNEL_BATCH_
@@ -0,0 +1,40 @@
+// NEON kernel for aarch64. The NEON code in filter/block.h loads its multipliers
+// in a different lane order from the scalar and AVX2 code, which gives a
+// different bit layout, so this kernel keeps the scalar lane order instead.
+#include <arm_neon.h>
+#include "sbbf_kernels.h"
+
+static inline void makeMask(uint64_t hash, uint32x4_t mask[2]){
+    static const uint32_t seeds[8] = {
+        0x44974d91, 0x47b6137b, 0xa2b7289d, 0x8824ad5b,
+        0x2df1424b, 0x705495c7, 0x5c6bfb31, 0x9efc4947};
+    const uint32x4_t ones = vmovq_n_u32(1);
+    const uint32x4_t h = vmovq_n_u32((uint32_t)hash);
+    for(int i = 0; i < 2; i++){
+        uint32x4_t shift = vshrq_n_u32(vmulq_u32(h, vld1q_u32(&seeds[4 * i])), 32 - 5);
+        mask[i] = vshlq_u32(ones, vreinterpretq_s32_u32(shift));
+    }
+}
+
+static void addHash(uint64_t hash, libfilter_block* filter){
+    uint32x4_t mask[2];
+    makeMask(hash, mask);
+    uint32_t* bucket = filter->block_.block + 8 * libfilter_block_index(hash, filter->num_buckets_);
+    vst1q_u32(&bucket[0], vorrq_u32(vld1q_u32(&bucket[0]), mask[0]));
+    vst1q_u32(&bucket[4], vorrq_u32(vld1q_u32(&bucket[4]), mask[1]));
+}
+
+static bool findHash(uint64_t hash, const libfilter_block* filter){
+    uint32x4_t mask[2];
+    makeMask(hash, mask);
+    const uint32_t* bucket = filter->block_.block + 8 * libfilter_block_index(hash, filter->num_buckets_);
+    uint32x4_t out0 = vandq_u32(vld1q_u32(&bucket[0]), mask[0]);
+    uint32x4_t out1 = vandq_u32(vld1q_u32(&bucket[4]), mask[1]);
+    return vminvq_u32(out0) && vminvq_u32(out1);
+}
+
+#include "sbbf_kernel_batch.h"
+
+const SbbfKernel sbbf_kernel_neon = {"neon", addHash, findHash, addBatch, findBatch,
+                                         findBatchAny, orBuckets, andBuckets,
+                                         countBuckets};
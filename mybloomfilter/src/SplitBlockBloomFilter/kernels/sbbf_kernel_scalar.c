@@ -0,0 +1,16 @@
+// Portable kernel, built without any instruction set flags.
+#include "sbbf_kernels.h"
+
+static void addHash(uint64_t hash, libfilter_block* filter){
+    libfilter_block_scalar_add_hash(hash, filter);
+}
+
+static bool findHash(uint64_t hash, const libfilter_block* filter){
+    return libfilter_block_scalar_find_hash(hash, filter);
+}
+
+#include "sbbf_kernel_batch.h"
+
+const SbbfKernel sbbf_kernel_scalar = {"scalar", addHash, findHash, addBatch, findBatch,
+                                         findBatchAny, orBuckets, andBuckets,
+                                         countBuckets};
@@ -0,0 +1,43 @@
+// Built with -msse4.1. filter/block.h has no SSE path, so the bucket is handled
+// as two 128-bit halves here, with the same lane order as the scalar kernel.
+#include <immintrin.h>
+#include "sbbf_kernels.h"
+
+static inline void makeMask(uint64_t hash, __m128i mask[2]){
+    const __m128i seeds[2] = {
+        _mm_setr_epi32(0x44974d91, 0x47b6137b, 0xa2b7289d, 0x8824ad5b),
+        _mm_setr_epi32(0x2df1424b, 0x705495c7, 0x5c6bfb31, 0x9efc4947)};
+    const __m128i h = _mm_set1_epi32((uint32_t)hash);
+    for(int i = 0; i < 2; i++){
+        __m128i shift = _mm_srli_epi32(_mm_mullo_epi32(h, seeds[i]), 32 - 5);
+        // SSE has no per-lane variable shift: build 2^shift as a float and convert
+        // it back. 2^31 does not fit an int32 and converts to 0x80000000, which is
+        // exactly 1 << 31.
+        __m128 power = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(shift, _mm_set1_epi32(127)), 23));
+        mask[i] = _mm_cvttps_epi32(power);
+    }
+}
+
+static void addHash(uint64_t hash, libfilter_block* filter){
+    __m128i mask[2];
+    makeMask(hash, mask);
+    __m128i* bucket = (__m128i*)filter->block_.block +
+        2 * libfilter_block_index(hash, filter->num_buckets_);
+    _mm_store_si128(&bucket[0], _mm_or_si128(_mm_load_si128(&bucket[0]), mask[0]));
+    _mm_store_si128(&bucket[1], _mm_or_si128(_mm_load_si128(&bucket[1]), mask[1]));
+}
+
+static bool findHash(uint64_t hash, const libfilter_block* filter){
+    __m128i mask[2];
+    makeMask(hash, mask);
+    const __m128i* bucket = (const __m128i*)filter->block_.block +
+        2 * libfilter_block_index(hash, filter->num_buckets_);
+    return _mm_testc_si128(_mm_load_si128(&bucket[0]), mask[0]) &
+           _mm_testc_si128(_mm_load_si128(&bucket[1]), mask[1]);
+}
+
+#include "sbbf_kernel_batch.h"
+
+const SbbfKernel sbbf_kernel_sse41 = {"sse41", addHash, findHash, addBatch, findBatch,
+                                         findBatchAny, orBuckets, andBuckets,
+                                         countBuckets};
@@ -0,0 +1,67 @@
+#ifndef _SBBF_KERNELS_
+#define _SBBF_KERNELS_
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filter/block.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//-----------------------------------------------------------------------------
+
+// The bucket operations of a split block filter, compiled once per instruction
+// set. Every kernel sets exactly the same bits for a hash, so a filter built with
+// one kernel can be read with any other.
+#define SBBF_BUCKET_BITS 256
+
+typedef struct SbbfKernel {
+    const char* name;
+    void (*AddHash)(uint64_t hash, libfilter_block* filter);
+    bool (*FindHash)(uint64_t hash, const libfilter_block* filter);
+    // Batch forms over at most 64 hashes. Every target bucket is prefetched
+    // first; FindBatch returns a word with bit i set when hashes[i] may be present.
+    void (*AddBatch)(const uint64_t* hashes, size_t count, libfilter_block* filter);
+    uint64_t (*FindBatch)(const uint64_t* hashes, size_t count, const libfilter_block* filter);
+    // Sets bit i when hashes[i] may be present in any of num_filters filters
+    // with the same bucket count. A hash selects the same bucket in all of
+    // them, so its bucket index and mask are computed once.
+    uint64_t (*FindBatchAny)(const uint64_t* hashes, size_t count, const libfilter_block* filters,
+                             size_t num_filters);
+    // dst[i] |= src[i] and dst[i] &= src[i] over num_buckets 32-byte buckets.
+    // Both arrays must be 32-byte aligned; 64-byte alignment is not required.
+    void (*OrBuckets)(uint32_t* dst, const uint32_t* src, size_t num_buckets);
+    void (*AndBuckets)(uint32_t* dst, const uint32_t* src, size_t num_buckets);
+    // Adds one to histogram[c] for every bucket with c bits set. histogram has
+    // SBBF_BUCKET_BITS + 1 entries.
+    void (*CountBuckets)(const uint32_t* buckets, size_t num_buckets, uint64_t* histogram);
+} SbbfKernel;
+
+extern const SbbfKernel sbbf_kernel_scalar;
+#if defined(__x86_64__)
+extern const SbbfKernel sbbf_kernel_sse41;
+extern const SbbfKernel sbbf_kernel_avx2;
+// Only built when the compiler takes -mavx512f, which defines
+// SBBF_HAVE_AVX512 for the dispatcher
+extern const SbbfKernel sbbf_kernel_avx512;
+#elif defined(__aarch64__)
+extern const SbbfKernel sbbf_kernel_neon;
+#endif
+
+// Picks the widest kernel the running CPU supports (cpuid on x86, getauxval on
+// ARM). Setting SBBF_KERNEL=scalar|sse41|avx2|avx512|neon in the environment
+// overrides the choice when that kernel is supported.
+const SbbfKernel* SbbfSelectKernel(void);
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _SBBF_KERNELS_
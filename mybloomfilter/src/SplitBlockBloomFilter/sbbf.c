@@ -2,43 +2,494 @@
 #include <assert.h>
 #include "sbbf.h"
 #include <stdlib.h>
-#include "murmur3.h"
+#include "../hashing/hashing.h"
+#include "kernels/sbbf_kernels.h"
+#include "../parallel/parallel_build.h"
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 
-SplitBlockBloomFilter* createSplitBlockBloomFilter(long int ndv, double fpp){
-    uint64_t bytes = libfilter_block_bytes_needed(ndv, fpp);
-    // libfilter_block filter;
-    libfilter_block* filter = (libfilter_block*)malloc(sizeof(libfilter_block));
-    if(!libfilter_block_init(bytes, filter)){
-        SplitBlockBloomFilter* bf = (SplitBlockBloomFilter*)malloc(sizeof(SplitBlockBloomFilter));
-        if(bf == NULL){
-            printf("Memory Not allocated!\n");
+// Bytes in front of the buckets of a created filter: the struct, padded so the
+// buckets start on a cache line of their own
+#define SBBF_HEADER_BYTES ((sizeof(SplitBlockBloomFilter) + 63) & ~(size_t)63)
+// Filters at least this large get a mapping of their own on huge pages
+#define SBBF_HUGEPAGE_BYTES ((size_t)2 << 20)
+
+// One zeroed, 64-byte aligned allocation holding the struct and payload_bytes
+// of buckets after it. A large filter is mapped on its own, aligned to 2 MB and
+// advised onto transparent huge pages so random probes miss the TLB less;
+// *mapped is then the size of the mapping, and 0 for a heap allocation.
+static SplitBlockBloomFilter* allocateFilter(uint64_t payload_bytes, size_t* mapped){
+    size_t bytes = SBBF_HEADER_BYTES + payload_bytes;
+    *mapped = 0;
+    if(bytes >= SBBF_HUGEPAGE_BYTES){
+        bytes = (bytes + SBBF_HUGEPAGE_BYTES - 1) & ~(SBBF_HUGEPAGE_BYTES - 1);
+        // Over-map by one huge page and trim both ends to an aligned range
+        char* region = (char*)mmap(NULL, bytes + SBBF_HUGEPAGE_BYTES, PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(region == MAP_FAILED){
             return NULL;
         }
-        bf->bit_array = filter;
-        bf->size = bytes * 8;
-        bf->Insert = Insert;
-        bf->CheckKey = CheckKey;
-        return bf;
+        char* start = (char*)(((uintptr_t)region + SBBF_HUGEPAGE_BYTES - 1) & ~(uintptr_t)(SBBF_HUGEPAGE_BYTES - 1));
+        if(start > region){
+            munmap(region, start - region);
+        }
+        munmap(start + bytes, region + SBBF_HUGEPAGE_BYTES - start);
+#ifdef MADV_HUGEPAGE
+        madvise(start, bytes, MADV_HUGEPAGE);
+#endif
+        *mapped = bytes;
+        return (SplitBlockBloomFilter*)start;
+    }
+    void* memory;
+    if(posix_memalign(&memory, 64, bytes) != 0){
+        return NULL;
+    }
+    memset(memory, 0, bytes);
+    return (SplitBlockBloomFilter*)memory;
+}
+
+static void freeFilter(SplitBlockBloomFilter* bf){
+    if(bf->allocation_size > 0){
+        munmap(bf, bf->allocation_size);
     }else{
+        free(bf);
+    }
+}
+
+// Fills in everything but the payload, shared by create and open
+static void initFilter(SplitBlockBloomFilter* bf, uint64_t num_buckets, uint32_t* payload,
+                       long int ndv, double fpp, uint32_t seed){
+    bf->filter.num_buckets_ = num_buckets;
+    bf->filter.block_.block = payload;
+    bf->filter.block_.to_free = NULL;
+    bf->kernel = SbbfSelectKernel();
+    bf->mapping = NULL;
+    bf->mapping_size = 0;
+    bf->size = libfilter_block_size_in_bytes(&bf->filter) * 8;
+    bf->hash_count = SBBF_HASH_COUNT;
+    bf->ndv = ndv;
+    bf->fpp = fpp;
+    bf->seed = seed;
+    bf->num_prefixes = 0;
+    bf->negatives_checked = 0;
+    bf->false_positives = 0;
+    bf->Insert = Insert;
+    bf->CheckKey = CheckKey;
+    bf->InsertBatch = InsertBatch;
+    bf->CheckKeyBatch = CheckKeyBatch;
+    bf->BuildFromKeys = SbbfBuildFromKeys;
+}
+
+SplitBlockBloomFilter* createSplitBlockBloomFilter(long int ndv, double fpp){
+    // Same bucket count as libfilter_block_init would pick
+    uint64_t num_buckets = libfilter_block_bytes_needed(ndv, fpp) / (8 * sizeof(uint32_t));
+    if(num_buckets == 0){
+        num_buckets = 1;
+    }
+    size_t mapped;
+    SplitBlockBloomFilter* bf = allocateFilter(num_buckets * 8 * sizeof(uint32_t), &mapped);
+    if(bf == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    initFilter(bf, num_buckets, (uint32_t*)((char*)bf + SBBF_HEADER_BYTES), ndv, fpp, SBBF_DEFAULT_SEED);
+    bf->allocation_size = mapped;
+    return bf;
+}
+
+void DestroySplitBlockBloomFilter(SplitBlockBloomFilter* bf){
+    if(bf->mapping != NULL){
+        munmap(bf->mapping, bf->mapping_size);
+    }
+    freeFilter(bf);
+}
+
+static int validHeader(const SbbfFileHeader* header, uint64_t file_size){
+    return memcmp(header->magic, SBBF_FILE_MAGIC, sizeof(header->magic)) == 0 &&
+           header->version == SBBF_FILE_VERSION &&
+           header->hash_id == SBBF_HASH_MURMUR3_X64_128_FOLDED &&
+           header->payload_offset == SBBF_FILE_PAYLOAD_OFFSET &&
+           header->payload_bytes == header->num_buckets * 8 * sizeof(uint32_t) &&
+           header->payload_offset + header->payload_bytes == file_size &&
+           header->num_prefixes <= SBBF_MAX_PREFIXES;
+}
+
+int SaveSplitBlockBloomFilter(const SplitBlockBloomFilter* bf, const char* path){
+    uint64_t bytes = libfilter_block_size_in_bytes(&bf->filter);
+    SbbfFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SBBF_FILE_MAGIC, sizeof(header.magic));
+    header.version = SBBF_FILE_VERSION;
+    header.hash_id = SBBF_HASH_MURMUR3_X64_128_FOLDED;
+    header.seed = bf->seed;
+    header.ndv = bf->ndv;
+    header.fpp = bf->fpp;
+    header.num_buckets = bf->filter.num_buckets_;
+    header.payload_offset = SBBF_FILE_PAYLOAD_OFFSET;
+    header.payload_bytes = bytes;
+    header.checksum = Checksum64(CHECKSUM64_BASIS, bf->filter.block_.block, bytes);
+    header.num_prefixes = bf->num_prefixes;
+    memcpy(header.prefix_lengths, bf->prefix_lengths, bf->num_prefixes * sizeof(uint32_t));
+
+    FILE* file = fopen(path, "wb");
+    if(file == NULL){
+        printf("Could not open %s for writing!\n", path);
+        return -1;
+    }
+    char padding[SBBF_FILE_PAYLOAD_OFFSET] = {0};
+    memcpy(padding, &header, sizeof(header));
+    int ok = fwrite(padding, 1, sizeof(padding), file) == sizeof(padding) &&
+             fwrite(bf->filter.block_.block, 1, bytes, file) == bytes;
+    ok = (fclose(file) == 0) && ok;
+    if(!ok){
+        printf("Could not write %s!\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+SplitBlockBloomFilter* OpenSplitBlockBloomFilter(const char* path, int verify){
+    int fd = open(path, O_RDONLY);
+    if(fd < 0){
+        printf("Could not open %s!\n", path);
+        return NULL;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (uint64_t)st.st_size < SBBF_FILE_PAYLOAD_OFFSET){
+        printf("%s is not a Split Block Bloom Filter file!\n", path);
+        close(fd);
+        return NULL;
+    }
+    // A private writable mapping shares the page cache copy with every other
+    // process until a page is written, so inserts stay local to this process.
+    void* mapping = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED){
+        printf("Could not map %s!\n", path);
+        return NULL;
+    }
+
+    const SbbfFileHeader* header = (const SbbfFileHeader*)mapping;
+    if(!validHeader(header, st.st_size)){
+        printf("%s is not a Split Block Bloom Filter file!\n", path);
+        munmap(mapping, st.st_size);
+        return NULL;
+    }
+    uint32_t* payload = (uint32_t*)((char*)mapping + header->payload_offset);
+    if(verify && Checksum64(CHECKSUM64_BASIS, payload, header->payload_bytes) != header->checksum){
+        printf("%s failed its checksum!\n", path);
+        munmap(mapping, st.st_size);
+        return NULL;
+    }
+    // Lookups hit random buckets; readahead would only pull in pages nobody asked for
+    madvise(payload, header->payload_bytes, MADV_RANDOM);
+
+    size_t mapped;
+    SplitBlockBloomFilter* bf = allocateFilter(0, &mapped);
+    if(bf != NULL){
+        initFilter(bf, header->num_buckets, payload, header->ndv, header->fpp, header->seed);
+        bf->allocation_size = mapped;
+    }
+    if(bf != NULL && header->num_prefixes > 0 &&
+       SbbfEnablePrefixes(bf, header->prefix_lengths, header->num_prefixes) != 0){
+        freeFilter(bf);
+        bf = NULL;
+    }
+    if(bf == NULL){
         printf("Memory Not allocated!\n");
+        munmap(mapping, st.st_size);
         return NULL;
     }
+    bf->mapping = mapping;
+    bf->mapping_size = st.st_size;
+    return bf;
+}
+
+// Filters can only be combined bucket by bucket when keys map to the same
+// bucket and the same bits in both, and hold the same prefixes
+static int compatible(const SplitBlockBloomFilter* a, const SplitBlockBloomFilter* b){
+    if(a->filter.num_buckets_ != b->filter.num_buckets_ || a->seed != b->seed ||
+       a->num_prefixes != b->num_prefixes ||
+       memcmp(a->prefix_lengths, b->prefix_lengths, a->num_prefixes * sizeof(uint32_t)) != 0){
+        printf("Filters are not compatible!\n");
+        return 0;
+    }
+    return 1;
+}
+
+int Union(SplitBlockBloomFilter* dst, const SplitBlockBloomFilter* src){
+    if(!compatible(dst, src)){
+        return -1;
+    }
+    dst->kernel->OrBuckets(dst->filter.block_.block, src->filter.block_.block, dst->filter.num_buckets_);
+    return 0;
+}
+
+int Intersect(SplitBlockBloomFilter* dst, const SplitBlockBloomFilter* src){
+    if(!compatible(dst, src)){
+        return -1;
+    }
+    dst->kernel->AndBuckets(dst->filter.block_.block, src->filter.block_.block, dst->filter.num_buckets_);
+    return 0;
+}
+
+// Bytes of each input held in memory at once by the streaming merge
+#define SBBF_MERGE_CHUNK (1 << 20)
+
+int MergeSplitBlockBloomFilterFiles(const char* output, const char* const* inputs, size_t count, int op){
+    if(count == 0 || (op != SBBF_MERGE_UNION && op != SBBF_MERGE_INTERSECT)){
+        return -1;
+    }
+    const SbbfKernel* kernel = SbbfSelectKernel();
+    FILE** files = (FILE**)calloc(count, sizeof(FILE*));
+    SbbfFileHeader* headers = (SbbfFileHeader*)malloc(count * sizeof(SbbfFileHeader));
+    uint64_t* checksums = (uint64_t*)malloc(count * sizeof(uint64_t));
+    uint32_t* merged = (uint32_t*)aligned_alloc(64, SBBF_MERGE_CHUNK);
+    uint32_t* chunk = (uint32_t*)aligned_alloc(64, SBBF_MERGE_CHUNK);
+    SbbfFileHeader header;
+    FILE* out = NULL;
+    int result = -1;
+    if(files == NULL || headers == NULL || checksums == NULL || merged == NULL || chunk == NULL){
+        printf("Memory Not allocated!\n");
+        goto done;
+    }
+
+    for(size_t i = 0; i < count; i++){
+        struct stat st;
+        files[i] = fopen(inputs[i], "rb");
+        if(files[i] == NULL || fstat(fileno(files[i]), &st) != 0 ||
+           fread(&headers[i], sizeof(SbbfFileHeader), 1, files[i]) != 1 || !validHeader(&headers[i], st.st_size)){
+            printf("%s is not a Split Block Bloom Filter file!\n", inputs[i]);
+            goto done;
+        }
+        if(headers[i].num_buckets != headers[0].num_buckets || headers[i].seed != headers[0].seed ||
+           headers[i].num_prefixes != headers[0].num_prefixes ||
+           memcmp(headers[i].prefix_lengths, headers[0].prefix_lengths, sizeof(headers[0].prefix_lengths)) != 0){
+            printf("%s is not compatible with %s!\n", inputs[i], inputs[0]);
+            goto done;
+        }
+        checksums[i] = CHECKSUM64_BASIS;
+        if(fseek(files[i], headers[i].payload_offset, SEEK_SET) != 0){
+            goto done;
+        }
+    }
+
+    out = fopen(output, "wb");
+    if(out == NULL){
+        printf("Could not open %s for writing!\n", output);
+        goto done;
+    }
+    // Header goes in last, once the checksum of the merged payload is known
+    char padding[SBBF_FILE_PAYLOAD_OFFSET] = {0};
+    if(fwrite(padding, 1, sizeof(padding), out) != sizeof(padding)){
+        goto write_error;
+    }
+    header = headers[0];
+    header.checksum = CHECKSUM64_BASIS;
+    for(uint64_t offset = 0; offset < header.payload_bytes; offset += SBBF_MERGE_CHUNK){
+        size_t bytes = header.payload_bytes - offset < SBBF_MERGE_CHUNK ? header.payload_bytes - offset : SBBF_MERGE_CHUNK;
+        for(size_t i = 0; i < count; i++){
+            uint32_t* target = i == 0 ? merged : chunk;
+            if(fread(target, 1, bytes, files[i]) != bytes){
+                printf("Could not read %s!\n", inputs[i]);
+                goto done;
+            }
+            checksums[i] = Checksum64(checksums[i], target, bytes);
+            if(i == 0){
+                continue;
+            }
+            if(op == SBBF_MERGE_UNION){
+                kernel->OrBuckets(merged, chunk, bytes / (8 * sizeof(uint32_t)));
+            }else{
+                kernel->AndBuckets(merged, chunk, bytes / (8 * sizeof(uint32_t)));
+            }
+        }
+        header.checksum = Checksum64(header.checksum, merged, bytes);
+        if(fwrite(merged, 1, bytes, out) != bytes){
+            goto write_error;
+        }
+    }
+    for(size_t i = 0; i < count; i++){
+        if(checksums[i] != headers[i].checksum){
+            printf("%s failed its checksum!\n", inputs[i]);
+            goto done;
+        }
+    }
+    if(fseek(out, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, out) != 1){
+        goto write_error;
+    }
+    result = 0;
+    goto done;
+
+write_error:
+    printf("Could not write %s!\n", output);
+done:
+    if(out != NULL && fclose(out) != 0 && result == 0){
+        printf("Could not write %s!\n", output);
+        result = -1;
+    }
+    if(out != NULL && result != 0){
+        remove(output);
+    }
+    for(size_t i = 0; files != NULL && i < count; i++){
+        if(files[i] != NULL){
+            fclose(files[i]);
+        }
+    }
+    free(files);
+    free(headers);
+    free(checksums);
+    free(merged);
+    free(chunk);
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// Prefix mode
+
+// Prefixes are hashed with their own seed, so a prefix and a key with the
+// same bytes set different bits
+static inline uint32_t prefixSeed(const SplitBlockBloomFilter* bf){
+    return bf->seed ^ 0x9e3779b9;
+}
+
+// Hash of the first length bytes of key, zero padded when the key is shorter
+static uint64_t prefixHash(const SplitBlockBloomFilter* bf, const void* key, size_t size, uint32_t length){
+    if(size >= length){
+        return HashKey64(key, length, prefixSeed(bf));
+    }
+    char padded[SBBF_MAX_PREFIX_LENGTH] = {0};
+    memcpy(padded, key, size);
+    return HashKey64(padded, length, prefixSeed(bf));
+}
+
+// Writes the prefix hashes of a key to out and returns how many there are
+static inline size_t prefixHashes(const SplitBlockBloomFilter* bf, const void* key, size_t size, uint64_t* out){
+    for(int i = 0; i < bf->num_prefixes; i++){
+        out[i] = prefixHash(bf, key, size, bf->prefix_lengths[i]);
+    }
+    return bf->num_prefixes;
+}
+
+int SbbfEnablePrefixes(SplitBlockBloomFilter* bf, const uint32_t* lengths, int count){
+    if(count < 1 || count > SBBF_MAX_PREFIXES){
+        printf("A filter takes 1 to %d prefix lengths!\n", SBBF_MAX_PREFIXES);
+        return -1;
+    }
+    uint32_t sorted[SBBF_MAX_PREFIXES];
+    int distinct = 0;
+    for(int i = 0; i < count; i++){
+        if(lengths[i] < 1 || lengths[i] > SBBF_MAX_PREFIX_LENGTH){
+            printf("Prefix lengths must be 1 to %d bytes!\n", SBBF_MAX_PREFIX_LENGTH);
+            return -1;
+        }
+        // Insertion sort, dropping repeats
+        int j = distinct;
+        while(j > 0 && sorted[j - 1] > lengths[i]){
+            j--;
+        }
+        if(j > 0 && sorted[j - 1] == lengths[i]){
+            continue;
+        }
+        memmove(&sorted[j + 1], &sorted[j], (distinct - j) * sizeof(uint32_t));
+        sorted[j] = lengths[i];
+        distinct++;
+    }
+    memcpy(bf->prefix_lengths, sorted, distinct * sizeof(uint32_t));
+    bf->num_prefixes = distinct;
+    return 0;
+}
+
+int MayContainPrefix(SplitBlockBloomFilter* bf, const void* prefix, size_t size){
+    for(int i = 0; i < bf->num_prefixes; i++){
+        if(bf->prefix_lengths[i] == size){
+            return bf->kernel->FindHash(HashKey64(prefix, size, prefixSeed(bf)), &bf->filter);
+        }
+    }
+    return 1;
 }
 
+// Bytewise order, a proper prefix sorting first
+static int compareKeys(const void* a, size_t a_size, const void* b, size_t b_size){
+    int order = memcmp(a, b, a_size < b_size ? a_size : b_size);
+    if(order != 0){
+        return order;
+    }
+    return (a_size > b_size) - (a_size < b_size);
+}
+
+// Probes every length-byte prefix from that of lo to that of hi. Returns 0 when
+// none is present, 1 when one may be and -1 when there are too many to probe.
+// Zero padding keeps the order: a key in [lo, hi] has its padded prefix between
+// the padded prefixes of lo and hi.
+static int probeRange(SplitBlockBloomFilter* bf, const void* lo, size_t lo_size,
+                      const void* hi, size_t hi_size, uint32_t length){
+    unsigned char first[SBBF_MAX_PREFIX_LENGTH] = {0};
+    unsigned char last[SBBF_MAX_PREFIX_LENGTH] = {0};
+    memcpy(first, lo, lo_size < length ? lo_size : length);
+    memcpy(last, hi, hi_size < length ? hi_size : length);
+    uint32_t common = 0;
+    while(common < length && first[common] == last[common]){
+        common++;
+    }
+    // Prefixes in the range differ only in their last length - common bytes
+    uint32_t width = length - common;
+    if(width > sizeof(uint64_t)){
+        return -1;
+    }
+    uint64_t begin = 0, end = 0;
+    for(uint32_t i = common; i < length; i++){
+        begin = begin << 8 | first[i];
+        end = end << 8 | last[i];
+    }
+    if(end - begin >= SBBF_RANGE_PROBES){
+        return -1;
+    }
+    uint64_t hashes[SBBF_RANGE_PROBES];
+    size_t count = 0;
+    for(uint64_t value = begin; value <= end; value++){
+        for(uint32_t i = 0; i < width; i++){
+            first[length - 1 - i] = (unsigned char)(value >> (8 * i));
+        }
+        hashes[count++] = HashKey64(first, length, prefixSeed(bf));
+    }
+    return bf->kernel->FindBatch(hashes, count, &bf->filter) != 0;
+}
+
+int MayContainRange(SplitBlockBloomFilter* bf, const void* lo, size_t lo_size, const void* hi, size_t hi_size){
+    if(compareKeys(lo, lo_size, hi, hi_size) > 0){
+        return 0;
+    }
+    // A coarser length can rule out a range that a finer one let through on a
+    // false positive, so every length gets a say
+    for(int i = bf->num_prefixes - 1; i >= 0; i--){
+        if(probeRange(bf, lo, lo_size, hi, hi_size, bf->prefix_lengths[i]) == 0){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+//-----------------------------------------------------------------------------
+
 void Insert(SplitBlockBloomFilter* bf, const void* str, size_t size){
-    uint64_t hash = 0;
-    uint32_t seed = 0xfeedba;
-    MurmurHash3_x86_32(str, size, seed, &hash);
-    libfilter_block_add_hash(hash, bf->bit_array);
+    uint64_t hash = HashKey64(str, size, bf->seed);
+    bf->kernel->AddHash(hash, &bf->filter);
+    if(bf->num_prefixes > 0){
+        uint64_t hashes[SBBF_MAX_PREFIXES];
+        bf->kernel->AddBatch(hashes, prefixHashes(bf, str, size, hashes), &bf->filter);
+    }
 }
 
 int CheckKey(SplitBlockBloomFilter* bf, const void* str, size_t size){
-    uint64_t hash = 0;
-    uint32_t seed = 0xfeedba;
-    MurmurHash3_x86_32(str, size, seed, &hash);
-    if(libfilter_block_find_hash(hash, bf->bit_array)){
+    uint64_t hash = HashKey64(str, size, bf->seed);
+    if(bf->kernel->FindHash(hash, &bf->filter)){
         // printf("Element has been found\n");
         return 0;
     }else {
@@ -46,3 +497,239 @@ int CheckKey(SplitBlockBloomFilter* bf, const void* str, size_t size){
         return 1;
     }
 }
+
+// Keys are handled in groups of 64 so that one group fills one word of the
+// result bitmap and its hashes stay in L1.
+#define SBBF_BATCH 64
+
+// Adds the prefixes of count keys, SBBF_BATCH / SBBF_MAX_PREFIXES keys at a
+// time so their hashes fill one kernel batch
+static void insertPrefixBatch(SplitBlockBloomFilter* bf, const char* keys, size_t key_size, size_t count){
+    uint64_t hashes[SBBF_BATCH];
+    for(size_t start = 0; start < count; start += SBBF_BATCH / SBBF_MAX_PREFIXES){
+        size_t end = count - start < SBBF_BATCH / SBBF_MAX_PREFIXES ? count : start + SBBF_BATCH / SBBF_MAX_PREFIXES;
+        size_t filled = 0;
+        for(size_t i = start; i < end; i++){
+            filled += prefixHashes(bf, keys + i * key_size, key_size, hashes + filled);
+        }
+        bf->kernel->AddBatch(hashes, filled, &bf->filter);
+    }
+}
+
+void InsertBatch(SplitBlockBloomFilter* bf, const void* keys, size_t key_size, size_t n){
+    uint64_t hashes[SBBF_BATCH];
+    const char* key = (const char*)keys;
+    for(size_t start = 0; start < n; start += SBBF_BATCH){
+        size_t count = (n - start < SBBF_BATCH) ? n - start : SBBF_BATCH;
+        HashKeys64(key + start * key_size, key_size, count, bf->seed, hashes);
+        bf->kernel->AddBatch(hashes, count, &bf->filter);
+        if(bf->num_prefixes > 0){
+            insertPrefixBatch(bf, key + start * key_size, key_size, count);
+        }
+    }
+}
+
+void CheckKeyBatch(SplitBlockBloomFilter* bf, const void* keys, size_t key_size, size_t n, uint64_t* result){
+    uint64_t hashes[SBBF_BATCH];
+    const char* key = (const char*)keys;
+    for(size_t start = 0; start < n; start += SBBF_BATCH){
+        size_t count = (n - start < SBBF_BATCH) ? n - start : SBBF_BATCH;
+        HashKeys64(key + start * key_size, key_size, count, bf->seed, hashes);
+        result[start / SBBF_BATCH] = bf->kernel->FindBatch(hashes, count, &bf->filter);
+    }
+}
+
+void EnableConcurrentInserts(SplitBlockBloomFilter* bf){
+    bf->Insert = InsertConcurrent;
+    bf->InsertBatch = InsertBatchConcurrent;
+}
+
+// Bits are only ever set, so ORing each word atomically is enough for several
+// writers to agree on the final bucket. Words that already hold their bit are
+// skipped to keep hot buckets from bouncing between cores. Lookups keep using
+// the plain SIMD loads of the kernel: a racing lookup sees every word either
+// before or after the OR, so keys whose insert has returned are always found.
+static inline void addHashConcurrent(uint64_t hash, libfilter_block* filter){
+    const uint64_t bucket_idx = libfilter_block_index(hash, filter->num_buckets_);
+    const libfilter_block_scalar_bucket mask = libfilter_block_scalar_make_mask(hash);
+    uint32_t* bucket = filter->block_.block + bucket_idx * 8;
+    for(int i = 0; i < 8; i++){
+        if((__atomic_load_n(&bucket[i], __ATOMIC_RELAXED) & mask.payload[i]) == 0){
+            __atomic_fetch_or(&bucket[i], mask.payload[i], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void addPrefixesConcurrent(SplitBlockBloomFilter* bf, const void* str, size_t size){
+    uint64_t hashes[SBBF_MAX_PREFIXES];
+    size_t count = prefixHashes(bf, str, size, hashes);
+    for(size_t i = 0; i < count; i++){
+        addHashConcurrent(hashes[i], &bf->filter);
+    }
+}
+
+void InsertConcurrent(SplitBlockBloomFilter* bf, const void* str, size_t size){
+    uint64_t hash = HashKey64(str, size, bf->seed);
+    addHashConcurrent(hash, &bf->filter);
+    addPrefixesConcurrent(bf, str, size);
+}
+
+static void addBatchConcurrent(const uint64_t* hashes, size_t count, libfilter_block* filter){
+    for(size_t i = 0; i < count; i++){
+        __builtin_prefetch(filter->block_.block +
+                           libfilter_block_index(hashes[i], filter->num_buckets_) * 8, 1);
+    }
+    for(size_t i = 0; i < count; i++){
+        addHashConcurrent(hashes[i], filter);
+    }
+}
+
+void InsertBatchConcurrent(SplitBlockBloomFilter* bf, const void* keys, size_t key_size, size_t n){
+    uint64_t hashes[SBBF_BATCH];
+    const char* key = (const char*)keys;
+    for(size_t start = 0; start < n; start += SBBF_BATCH){
+        size_t count = (n - start < SBBF_BATCH) ? n - start : SBBF_BATCH;
+        HashKeys64(key + start * key_size, key_size, count, bf->seed, hashes);
+        addBatchConcurrent(hashes, count, &bf->filter);
+        for(size_t i = 0; bf->num_prefixes > 0 && i < count; i++){
+            addPrefixesConcurrent(bf, key + (start + i) * key_size, key_size);
+        }
+    }
+}
+
+int SbbfFindHash(const SplitBlockBloomFilter* bf, uint64_t hash){
+    return bf->kernel->FindHash(hash, &bf->filter);
+}
+
+void SbbfInsertHash(SplitBlockBloomFilter* bf, uint64_t hash){
+    bf->kernel->AddHash(hash, &bf->filter);
+}
+
+uint64_t SbbfHashKey(const SplitBlockBloomFilter* bf, const void* str, size_t size){
+    return HashKey64(str, size, bf->seed);
+}
+
+uint64_t SbbfHashU64(const SplitBlockBloomFilter* bf, uint64_t key){
+    return HashU64(key, bf->seed);
+}
+
+// The U64 inserts follow whichever insert path bf->Insert points at
+static inline int concurrent(const SplitBlockBloomFilter* bf){
+    return bf->Insert == InsertConcurrent;
+}
+
+void InsertU64(SplitBlockBloomFilter* bf, uint64_t key){
+    uint64_t hash = HashU64(key, bf->seed);
+    if(concurrent(bf)){
+        addHashConcurrent(hash, &bf->filter);
+    }else{
+        bf->kernel->AddHash(hash, &bf->filter);
+    }
+}
+
+int CheckKeyU64(SplitBlockBloomFilter* bf, uint64_t key){
+    return !bf->kernel->FindHash(HashU64(key, bf->seed), &bf->filter);
+}
+
+void InsertU64Batch(SplitBlockBloomFilter* bf, const uint64_t* keys, size_t n){
+    uint64_t hashes[SBBF_BATCH];
+    for(size_t start = 0; start < n; start += SBBF_BATCH){
+        size_t count = (n - start < SBBF_BATCH) ? n - start : SBBF_BATCH;
+        HashKeysU64(keys + start, count, bf->seed, hashes);
+        if(concurrent(bf)){
+            addBatchConcurrent(hashes, count, &bf->filter);
+        }else{
+            bf->kernel->AddBatch(hashes, count, &bf->filter);
+        }
+    }
+}
+
+void CheckKeyU64Batch(SplitBlockBloomFilter* bf, const uint64_t* keys, size_t n, uint64_t* result){
+    uint64_t hashes[SBBF_BATCH];
+    for(size_t start = 0; start < n; start += SBBF_BATCH){
+        size_t count = (n - start < SBBF_BATCH) ? n - start : SBBF_BATCH;
+        HashKeysU64(keys + start, count, bf->seed, hashes);
+        result[start / SBBF_BATCH] = bf->kernel->FindBatch(hashes, count, &bf->filter);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void SbbfGetStats(const SplitBlockBloomFilter* bf, SbbfStats* stats){
+    const libfilter_block* filter = &bf->filter;
+    memset(stats, 0, sizeof(*stats));
+    stats->num_buckets = filter->num_buckets_;
+    stats->bits = (uint64_t)filter->num_buckets_ * SBBF_BUCKET_BITS;
+    bf->kernel->CountBuckets(filter->block_.block, filter->num_buckets_, stats->bucket_fill);
+
+    // A missing key lands in a bucket with c bits set and needs one set bit in
+    // each of its 8 words, about (c / 256)^8 when the words fill evenly
+    double fpp = 0;
+    for(int c = 1; c < SBBF_FILL_BINS; c++){
+        stats->bits_set += c * stats->bucket_fill[c];
+        fpp += stats->bucket_fill[c] * pow((double)c / SBBF_BUCKET_BITS, SBBF_HASH_COUNT);
+    }
+    stats->fill_ratio = stats->bits > 0 ? (double)stats->bits_set / stats->bits : 0;
+    stats->fill_fpp = stats->num_buckets > 0 ? fpp / stats->num_buckets : 0;
+
+    // Each key sets one of the 32 bits of word i in one of the buckets, so a
+    // given bit is still clear after n keys with probability (1 - 1 / 32B)^n
+    if(stats->bits_set == stats->bits){
+        stats->estimated_ndv = INFINITY;
+        stats->predicted_fpp = 1;
+    }else{
+        double per_word = 32.0 * stats->num_buckets;
+        stats->estimated_ndv = log1p(-stats->fill_ratio) / log1p(-1 / per_word);
+        stats->predicted_fpp = libfilter_block_fpp(stats->estimated_ndv, stats->bits / 8);
+    }
+
+    stats->negatives_checked = __atomic_load_n(&bf->negatives_checked, __ATOMIC_RELAXED);
+    stats->false_positives = __atomic_load_n(&bf->false_positives, __ATOMIC_RELAXED);
+    stats->observed_fpp = stats->negatives_checked > 0 ?
+        (double)stats->false_positives / stats->negatives_checked : 0;
+}
+
+int SbbfCheckNegative(SplitBlockBloomFilter* bf, const void* str, size_t size){
+    int absent = bf->CheckKey(bf, str, size);
+    __atomic_fetch_add(&bf->negatives_checked, 1, __ATOMIC_RELAXED);
+    if(!absent){
+        __atomic_fetch_add(&bf->false_positives, 1, __ATOMIC_RELAXED);
+    }
+    return absent;
+}
+
+void SbbfResetNegatives(SplitBlockBloomFilter* bf){
+    __atomic_store_n(&bf->negatives_checked, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&bf->false_positives, 0, __ATOMIC_RELAXED);
+}
+
+//-----------------------------------------------------------------------------
+
+static size_t sbbfExpand(void* ctx, const void* keys, size_t key_size, size_t n, uint64_t* out){
+    SplitBlockBloomFilter* bf = (SplitBlockBloomFilter*)ctx;
+    HashKeys64(keys, key_size, n, bf->seed, out);
+    size_t written = n;
+    for(size_t i = 0; i < n; i++){
+        written += prefixHashes(bf, (const char*)keys + i * key_size, key_size, out + written);
+    }
+    return written;
+}
+
+static uint64_t sbbfUnit(void* ctx, uint64_t hash){
+    SplitBlockBloomFilter* bf = (SplitBlockBloomFilter*)ctx;
+    return libfilter_block_index(hash, bf->filter.num_buckets_);
+}
+
+static void sbbfApply(void* ctx, const uint64_t* hashes, size_t n){
+    SplitBlockBloomFilter* bf = (SplitBlockBloomFilter*)ctx;
+    for(size_t start = 0; start < n; start += SBBF_BATCH){
+        size_t count = (n - start < SBBF_BATCH) ? n - start : SBBF_BATCH;
+        bf->kernel->AddBatch(hashes + start, count, &bf->filter);
+    }
+}
+
+void SbbfBuildFromKeys(SplitBlockBloomFilter* bf, const void* keys, size_t key_size, size_t n, int threads){
+    ParallelBuildOps ops = {sbbfExpand, sbbfUnit, sbbfApply, bf->filter.num_buckets_,
+                            1 + (size_t)bf->num_prefixes};
+    ParallelBuild(&ops, bf, keys, key_size, n, threads);
+}
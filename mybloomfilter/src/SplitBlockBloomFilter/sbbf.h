@@ -14,17 +14,198 @@ extern "C" {
 
 //-----------------------------------------------------------------------------
 
+struct SbbfKernel;
+
+#define SBBF_DEFAULT_SEED 0xfeedba
+// Most prefix lengths a filter can index, and the longest prefix
+#define SBBF_MAX_PREFIXES 8
+#define SBBF_MAX_PREFIX_LENGTH 256
+
+// A created filter is one 64-byte aligned allocation: this struct, padded to a
+// cache line, then the buckets. The bucket count and bucket pointer come first,
+// so a lookup reads the struct's first line and then its bucket.
 typedef struct SplitBlockBloomFilter {
-    libfilter_block *bit_array;  // Bit array to store filter data
-    unsigned int size;                  // Size of the bit array (m)
+    libfilter_block filter;          // Bucket count and bucket array
+    const struct SbbfKernel *kernel;  // SIMD bucket kernel chosen for this CPU
+    void *mapping;                   // File mapping holding the buckets of an opened filter, else NULL
+    size_t mapping_size;
+    size_t allocation_size;          // Bytes of the anonymous mapping holding a large filter, 0 when heap allocated
+    uint64_t size;                  // Size of the bit array (m)
     long int hash_count;             // Number of hash functions (k)
+    long int ndv;                    // Distinct values the filter was sized for
+    double fpp;                      // Target false positive probability
+    uint32_t seed;                   // Seed of the key hash
+    int num_prefixes;                // Prefix lengths inserted with every key, 0 when off
+    uint32_t prefix_lengths[SBBF_MAX_PREFIXES];  // Ascending
+    uint64_t negatives_checked;      // Known negatives passed to SbbfCheckNegative
+    uint64_t false_positives;        // Those the filter reported as present
     void (*Insert)(struct SplitBlockBloomFilter* bf, const void* str, size_t size);
     int (*CheckKey)(struct SplitBlockBloomFilter* bf, const void* str, size_t size);
+    void (*InsertBatch)(struct SplitBlockBloomFilter* bf, const void* keys, size_t key_size, size_t n);
+    void (*CheckKeyBatch)(struct SplitBlockBloomFilter* bf, const void* keys, size_t key_size, size_t n, uint64_t* result);
+    void (*BuildFromKeys)(struct SplitBlockBloomFilter* bf, const void* keys, size_t key_size, size_t n, int threads);
 } SplitBlockBloomFilter;
 
 SplitBlockBloomFilter* createSplitBlockBloomFilter(long int n, double p);
+// Frees a filter from createSplitBlockBloomFilter or OpenSplitBlockBloomFilter
+void DestroySplitBlockBloomFilter(SplitBlockBloomFilter* bf);
 void Insert(SplitBlockBloomFilter* bf, const void* str, size_t size);
 int CheckKey(SplitBlockBloomFilter* bf, const void* str, size_t size);
+// Batch forms over n fixed-size keys stored back to back in keys. Keys are hashed
+// a batch at a time and every target bucket is prefetched before it is touched.
+void InsertBatch(SplitBlockBloomFilter* bf, const void* keys, size_t key_size, size_t n);
+// Sets bit i of result (n / 64 rounded up words) when key i may be present and
+// clears it when key i is definitely absent.
+void CheckKeyBatch(SplitBlockBloomFilter* bf, const void* keys, size_t key_size, size_t n, uint64_t* result);
+// Fast path for 64-bit integer keys, hashed with HashU64 instead of the byte
+// hash. Keys inserted this way must be looked up with CheckKeyU64 or
+// CheckKeyU64Batch, and prefix mode does not apply to them. The inserts are
+// safe alongside concurrent inserts once EnableConcurrentInserts was called.
+void InsertU64(SplitBlockBloomFilter* bf, uint64_t key);
+int CheckKeyU64(SplitBlockBloomFilter* bf, uint64_t key);
+void InsertU64Batch(SplitBlockBloomFilter* bf, const uint64_t* keys, size_t n);
+void CheckKeyU64Batch(SplitBlockBloomFilter* bf, const uint64_t* keys, size_t n, uint64_t* result);
+// Lookup and insert of a hash from SbbfHashKey or SbbfHashU64 through the
+// kernel picked for the running CPU, without a call through bf->CheckKey
+int SbbfFindHash(const SplitBlockBloomFilter* bf, uint64_t hash);
+void SbbfInsertHash(SplitBlockBloomFilter* bf, uint64_t hash);
+// Inline forms for hot loops. Built with -mavx2 they are the AVX2 bucket code
+// of filter/block.h, which sets the same bits as the kernels. Every other
+// build, the default one included, makes an out-of-line call to SbbfFindHash
+// and SbbfInsertHash: libfilter's scalar code is several times slower, and
+// its NEON code derives a different bucket mask, which would give false
+// negatives on keys the kernels inserted.
+// SbbfAddHash adds no prefixes and is not safe alongside concurrent inserts.
+static inline int SbbfMayContainHash(const SplitBlockBloomFilter* bf, uint64_t hash){
+#if defined(__AVX2__)
+    return libfilter_block_find_hash(hash, &bf->filter);
+#else
+    return SbbfFindHash(bf, hash);
+#endif
+}
+static inline void SbbfAddHash(SplitBlockBloomFilter* bf, uint64_t hash){
+#if defined(__AVX2__)
+    libfilter_block_add_hash(hash, &bf->filter);
+#else
+    SbbfInsertHash(bf, hash);
+#endif
+}
+// The hashes Insert and InsertU64 use for a key
+uint64_t SbbfHashKey(const SplitBlockBloomFilter* bf, const void* str, size_t size);
+uint64_t SbbfHashU64(const SplitBlockBloomFilter* bf, uint64_t key);
+// Points bf->Insert and bf->InsertBatch at the concurrent variants below, after
+// which any number of threads may insert into and look up in bf at once.
+void EnableConcurrentInserts(SplitBlockBloomFilter* bf);
+// Inserts that OR the bucket mask in with one atomic fetch_or per 32-bit word
+// instead of a read-modify-write of the whole 256-bit bucket
+void InsertConcurrent(SplitBlockBloomFilter* bf, const void* str, size_t size);
+void InsertBatchConcurrent(SplitBlockBloomFilter* bf, const void* keys, size_t key_size, size_t n);
+// Bulk inserts n fixed-size keys with the given number of threads. Hashes are
+// radix-partitioned by bucket range so each thread fills its own slice of the
+// payload; the result is bit-identical to inserting the keys one by one.
+void SbbfBuildFromKeys(SplitBlockBloomFilter* bf, const void* keys, size_t key_size, size_t n, int threads);
+// Prefix mode: from now on every insert also adds the first lengths[i] bytes
+// of the key, for each of the count lengths, so the filter can answer whether
+// any key with a given prefix exists. Keys shorter than a length are padded
+// with zero bytes. Call it on an empty filter, and size the filter for the
+// prefixes as well as the keys. Returns 0 on success and -1 when count or a
+// length is out of range.
+int SbbfEnablePrefixes(SplitBlockBloomFilter* bf, const uint32_t* lengths, int count);
+// Returns 1 when a key starting with prefix may have been inserted and 0 when
+// none was. A prefix whose size is not one of the filter's lengths always
+// gets 1.
+int MayContainPrefix(SplitBlockBloomFilter* bf, const void* prefix, size_t size);
+// Returns 1 when a key in [lo, hi] (inclusive, compared bytewise, a proper
+// prefix sorting first) may have been inserted and 0 when none was. At every
+// prefix length where lo and hi span at most SBBF_RANGE_PROBES prefixes, all of
+// them are probed, and the range is empty if any length finds none; wider
+// ranges get 1. Always 1 without prefix mode.
+int MayContainRange(SplitBlockBloomFilter* bf, const void* lo, size_t lo_size, const void* hi, size_t hi_size);
+#define SBBF_RANGE_PROBES 16
+
+// Every key sets one bit in each of the 8 32-bit words of its bucket
+#define SBBF_HASH_COUNT 8
+#define SBBF_FILL_BINS 257             // One per possible bit count of a bucket
+
+typedef struct SbbfStats {
+    uint64_t num_buckets;
+    uint64_t bits;                     // Bits in the bit array
+    uint64_t bits_set;
+    double fill_ratio;                 // bits_set / bits
+    uint64_t bucket_fill[SBBF_FILL_BINS]; // Buckets with i of their 256 bits set
+    // Distinct keys inserted, estimated from bits_set. Prefixes count as keys.
+    // INFINITY once every bit is set.
+    double estimated_ndv;
+    double predicted_fpp;              // libfilter_block_fpp at estimated_ndv
+    // Chance that a key never inserted is reported present, from the bucket
+    // fill; unlike predicted_fpp it sees skew between buckets
+    double fill_fpp;
+    uint64_t negatives_checked;        // Counters of SbbfCheckNegative
+    uint64_t false_positives;
+    double observed_fpp;               // false_positives / negatives_checked, 0 before any
+} SbbfStats;
+
+// Reads the whole bit array to fill in stats, counting bits with the SIMD
+// kernel. Cheap enough to run from a periodic health check: it streams the
+// payload once and allocates nothing.
+void SbbfGetStats(const SplitBlockBloomFilter* bf, SbbfStats* stats);
+// Looks up a key the caller knows was never inserted and counts the answer
+// towards observed_fpp. Feed it a sample of known negatives, e.g. every
+// thousandth lookup that a backing store later answered as absent. Returns
+// what CheckKey returns. Safe alongside concurrent lookups and inserts.
+int SbbfCheckNegative(SplitBlockBloomFilter* bf, const void* str, size_t size);
+// Zeroes the counters of SbbfCheckNegative
+void SbbfResetNegatives(SplitBlockBloomFilter* bf);
+
+// Fold src into dst, so dst answers for the keys of both filters (Union) or
+// only reports keys that may be in both (Intersect). The intersection may have
+// a higher FPP than a filter built from the common keys alone. The filters must
+// have the same bucket count, seed and prefix lengths; returns 0 on success and
+// -1 otherwise.
+int Union(SplitBlockBloomFilter* dst, const SplitBlockBloomFilter* src);
+int Intersect(SplitBlockBloomFilter* dst, const SplitBlockBloomFilter* src);
+
+// On-disk format: a header padded to SBBF_FILE_PAYLOAD_OFFSET bytes followed by
+// the raw bucket array, so the payload of a mapped file is page aligned and can
+// be probed in place. Header fields and buckets are stored in native byte
+// order, so a file is read on hosts of the same endianness as the writer.
+#define SBBF_FILE_MAGIC "SBBF"
+#define SBBF_FILE_VERSION 1
+#define SBBF_FILE_PAYLOAD_OFFSET 4096
+// Hash function ids
+#define SBBF_HASH_MURMUR3_X64_128_FOLDED 1  // HashKey64
+
+typedef struct SbbfFileHeader {
+    char magic[4];              // SBBF_FILE_MAGIC
+    uint32_t version;           // SBBF_FILE_VERSION
+    uint32_t hash_id;           // Hash function the keys were hashed with
+    uint32_t seed;              // Seed of that hash function
+    uint64_t ndv;
+    double fpp;
+    uint64_t num_buckets;       // 32-byte buckets in the payload
+    uint64_t payload_offset;
+    uint64_t payload_bytes;
+    uint64_t checksum;          // FNV-1a over the payload words
+    uint32_t num_prefixes;      // Zero in files written before prefix mode
+    uint32_t prefix_lengths[SBBF_MAX_PREFIXES];
+} SbbfFileHeader;
+
+// Writes bf to path. Returns 0 on success and -1 on error.
+int SaveSplitBlockBloomFilter(const SplitBlockBloomFilter* bf, const char* path);
+// Maps a saved filter and serves lookups straight from the mapped pages, so
+// processes opening the same file share one page cache copy and opening costs
+// no copy of the payload. Inserts go to private copy-on-write pages and are not
+// written back. When verify is non-zero the payload checksum is checked, which
+// reads the whole file. Returns NULL on error.
+SplitBlockBloomFilter* OpenSplitBlockBloomFilter(const char* path, int verify);
+
+#define SBBF_MERGE_UNION 0
+#define SBBF_MERGE_INTERSECT 1
+// Unions or intersects count saved filters into a new file at output, reading
+// the inputs a chunk at a time so memory use does not grow with filter size.
+// Every input checksum is checked along the way. Returns 0 on success and -1
+// on error, in which case output is removed.
+int MergeSplitBlockBloomFilterFiles(const char* output, const char* const* inputs, size_t count, int op);
 
 
 //-----------------------------------------------------------------------------
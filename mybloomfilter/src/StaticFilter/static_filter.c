@@ -0,0 +1,404 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "static_filter.h"
+#include "../hashing/hashing.h"
+#include "../parallel/parallel_build.h"
+
+#define STATIC_ARITY 3
+// Lookups per prefetch batch
+#define STATIC_BATCH 64
+// Keys the iterator builder copies out before hashing them in parallel
+#define STATIC_ITERATOR_BATCH (1 << 16)
+
+typedef struct {
+    uint64_t slot[STATIC_ARITY];
+    uint8_t fingerprint;
+} Edge;
+
+// libfilter_make_edge with the window computed once per filter instead of once
+// per key: the three slots lie in [start, start + window) and are distinct.
+static uint64_t windowFor(uint64_t length){
+    uint64_t window = STATIC_ARITY + pow(length, 2.0 / 3.0);
+    return window > length ? length : window;
+}
+
+static inline void makeEdge(uint64_t hash, uint64_t length, uint64_t window, Edge* edge){
+    uint64_t start = (uint64_t)(((unsigned __int128)hash * (length - window)) >> 64);
+    hash *= length - window;
+    for(int j = 0; j < STATIC_ARITY; j++){
+        uint64_t slot = (uint64_t)(((unsigned __int128)hash * window) >> 64);
+        for(int seen = 0; seen < j; seen++){
+            if(slot + start == edge->slot[seen]){
+                slot = slot + 1 == window ? 0 : slot + 1;
+                seen = -1;
+            }
+        }
+        edge->slot[j] = slot + start;
+        hash *= window;
+    }
+    edge->fingerprint = hash >> (64 - 8);
+}
+
+static inline int findEdge(const uint8_t* fingerprints, const Edge* edge){
+    return (edge->fingerprint ^ fingerprints[edge->slot[0]] ^ fingerprints[edge->slot[1]] ^
+            fingerprints[edge->slot[2]]) == 0;
+}
+
+static int compareHashes(const void* a, const void* b){
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Peels the 3-hypergraph with one edge per hash: a slot that only one edge
+// touches can be assigned last for that edge, which removes the edge and may
+// leave more such slots. Fills fingerprints (length bytes, zeroed) and returns
+// 0 when every edge peels, -1 when a core remains or memory runs out.
+static int peel(const uint64_t* hashes, size_t n, uint64_t length, uint8_t* fingerprints){
+    uint64_t window = windowFor(length);
+    uint32_t* count = (uint32_t*)calloc(length, sizeof(uint32_t));
+    uint64_t* xored = (uint64_t*)calloc(length, sizeof(uint64_t));
+    uint64_t* queue = (uint64_t*)malloc(length * sizeof(uint64_t));
+    uint64_t* order = (uint64_t*)malloc(n * sizeof(uint64_t));
+    uint64_t* order_slot = (uint64_t*)malloc(n * sizeof(uint64_t));
+    size_t peeled = 0;
+    int result = -1;
+    if(count == NULL || xored == NULL || queue == NULL || order == NULL || order_slot == NULL){
+        printf("Memory Not allocated!\n");
+        goto done;
+    }
+
+    Edge edge;
+    for(size_t i = 0; i < n; i++){
+        makeEdge(hashes[i], length, window, &edge);
+        for(int j = 0; j < STATIC_ARITY; j++){
+            count[edge.slot[j]]++;
+            xored[edge.slot[j]] ^= hashes[i];
+        }
+    }
+    size_t queued = 0;
+    for(uint64_t v = 0; v < length; v++){
+        if(count[v] == 1){
+            queue[queued++] = v;
+        }
+    }
+    for(size_t next = 0; next < queued; next++){
+        uint64_t v = queue[next];
+        if(count[v] != 1){
+            continue;
+        }
+        // The only edge left on v is the one whose hash xored holds
+        uint64_t hash = xored[v];
+        order[peeled] = hash;
+        order_slot[peeled++] = v;
+        makeEdge(hash, length, window, &edge);
+        for(int j = 0; j < STATIC_ARITY; j++){
+            uint64_t u = edge.slot[j];
+            count[u]--;
+            xored[u] ^= hash;
+            if(count[u] == 1){
+                queue[queued++] = u;
+            }
+        }
+    }
+    if(peeled != n){
+        goto done;
+    }
+    // In reverse peel order each edge's free slot is untouched by every edge
+    // assigned so far, so setting it fixes the XOR for this edge for good
+    for(size_t i = peeled; i-- > 0;){
+        makeEdge(order[i], length, window, &edge);
+        fingerprints[order_slot[i]] = edge.fingerprint ^ fingerprints[edge.slot[0]] ^
+                                      fingerprints[edge.slot[1]] ^ fingerprints[edge.slot[2]];
+    }
+    result = 0;
+
+done:
+    free(count);
+    free(xored);
+    free(queue);
+    free(order);
+    free(order_slot);
+    return result;
+}
+
+static StaticFilter* newFilter(uint8_t* fingerprints, uint64_t length, uint64_t num_keys, uint32_t seed){
+    StaticFilter* sf = (StaticFilter*)malloc(sizeof(StaticFilter));
+    if(sf == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    sf->fingerprints = fingerprints;
+    sf->length = length;
+    sf->window = windowFor(length);
+    sf->num_keys = num_keys;
+    sf->seed = seed;
+    sf->mapping = NULL;
+    sf->mapping_size = 0;
+    sf->CheckKey = StaticCheckKey;
+    return sf;
+}
+
+// Takes ownership of hashes, which may be reordered
+static StaticFilter* buildFromHashes(uint64_t* hashes, size_t n){
+    // 1.13 slots per key peels with high probability for large n once the
+    // probes are spatially coupled; small sets need some slack on top
+    uint64_t length = (uint64_t)(1.13 * n) + 32;
+    int deduplicated = 0;
+    for(;;){
+        uint8_t* fingerprints = (uint8_t*)calloc(length, 1);
+        if(fingerprints == NULL){
+            printf("Memory Not allocated!\n");
+            break;
+        }
+        if(peel(hashes, n, length, fingerprints) == 0){
+            StaticFilter* sf = newFilter(fingerprints, length, n, STATIC_FILTER_SEED);
+            if(sf == NULL){
+                free(fingerprints);
+            }
+            free(hashes);
+            return sf;
+        }
+        free(fingerprints);
+        if(!deduplicated){
+            // Equal hashes can never peel; they are rare enough to only look
+            // for them once a build fails
+            qsort(hashes, n, sizeof(uint64_t), compareHashes);
+            size_t unique = 0;
+            for(size_t i = 0; i < n; i++){
+                if(unique == 0 || hashes[i] != hashes[unique - 1]){
+                    hashes[unique++] = hashes[i];
+                }
+            }
+            deduplicated = 1;
+            if(unique != n){
+                n = unique;
+                continue;
+            }
+        }
+        length += length / 20 + 16;
+    }
+    free(hashes);
+    return NULL;
+}
+
+StaticFilter* BuildStaticFilterFromHashes(const uint64_t* hashes, size_t n){
+    uint64_t* copy = (uint64_t*)malloc((n > 0 ? n : 1) * sizeof(uint64_t));
+    if(copy == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    memcpy(copy, hashes, n * sizeof(uint64_t));
+    return buildFromHashes(copy, n);
+}
+
+typedef struct {
+    const char* keys;
+    size_t key_size;
+    uint64_t* hashes;
+} FixedKeys;
+
+static void hashFixedKeys(void* ctx, size_t begin, size_t end){
+    FixedKeys* k = (FixedKeys*)ctx;
+    HashKeys64(k->keys + begin * k->key_size, k->key_size, end - begin, STATIC_FILTER_SEED, k->hashes + begin);
+}
+
+StaticFilter* BuildStaticFilterFromKeys(const void* keys, size_t key_size, size_t n, int threads){
+    uint64_t* hashes = (uint64_t*)malloc((n > 0 ? n : 1) * sizeof(uint64_t));
+    if(hashes == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    FixedKeys k = {(const char*)keys, key_size, hashes};
+    ParallelFor(n, threads, hashFixedKeys, &k);
+    return buildFromHashes(hashes, n);
+}
+
+typedef struct {
+    const char* arena;         // Keys of the batch back to back
+    const size_t* offset;      // offset[i] is where key i starts, offset[count] where the last ends
+    uint64_t* hashes;
+} KeyBatch;
+
+static void hashKeyBatch(void* ctx, size_t begin, size_t end){
+    KeyBatch* b = (KeyBatch*)ctx;
+    for(size_t i = begin; i < end; i++){
+        b->hashes[i] = HashKey64(b->arena + b->offset[i], b->offset[i + 1] - b->offset[i], STATIC_FILTER_SEED);
+    }
+}
+
+StaticFilter* BuildStaticFilter(StaticKeyIterator next, void* ctx, int threads){
+    size_t n = 0, capacity = STATIC_ITERATOR_BATCH;
+    size_t arena_capacity = 16 * STATIC_ITERATOR_BATCH;
+    uint64_t* hashes = (uint64_t*)malloc(capacity * sizeof(uint64_t));
+    size_t* offset = (size_t*)malloc((STATIC_ITERATOR_BATCH + 1) * sizeof(size_t));
+    char* arena = (char*)malloc(arena_capacity);
+    if(hashes == NULL || offset == NULL || arena == NULL){
+        goto fail;
+    }
+    for(int more = 1; more;){
+        // Copy out a batch, then hash it on every thread
+        size_t count = 0;
+        offset[0] = 0;
+        const void* key;
+        size_t size;
+        while(count < STATIC_ITERATOR_BATCH && (more = next(ctx, &key, &size))){
+            if(offset[count] + size > arena_capacity){
+                size_t grown = 2 * (offset[count] + size);
+                char* bigger = (char*)realloc(arena, grown);
+                if(bigger == NULL){
+                    goto fail;
+                }
+                arena = bigger;
+                arena_capacity = grown;
+            }
+            memcpy(arena + offset[count], key, size);
+            offset[count + 1] = offset[count] + size;
+            count++;
+        }
+        if(n + count > capacity){
+            uint64_t* bigger = (uint64_t*)realloc(hashes, 2 * capacity * sizeof(uint64_t));
+            if(bigger == NULL){
+                goto fail;
+            }
+            hashes = bigger;
+            capacity *= 2;
+        }
+        KeyBatch b = {arena, offset, hashes + n};
+        ParallelFor(count, threads, hashKeyBatch, &b);
+        n += count;
+    }
+    free(offset);
+    free(arena);
+    return buildFromHashes(hashes, n);
+
+fail:
+    printf("Memory Not allocated!\n");
+    free(hashes);
+    free(offset);
+    free(arena);
+    return NULL;
+}
+
+void DestroyStaticFilter(StaticFilter* sf){
+    if(sf->mapping != NULL){
+        munmap(sf->mapping, sf->mapping_size);
+    }else{
+        free(sf->fingerprints);
+    }
+    free(sf);
+}
+
+int StaticCheckKey(StaticFilter* sf, const void* str, size_t size){
+    Edge edge;
+    makeEdge(HashKey64(str, size, sf->seed), sf->length, sf->window, &edge);
+    return !findEdge(sf->fingerprints, &edge);
+}
+
+void StaticCheckKeyBatch(StaticFilter* sf, const void* keys, size_t key_size, size_t n, uint64_t* result){
+    const char* key = (const char*)keys;
+    uint64_t hashes[STATIC_BATCH];
+    Edge edges[STATIC_BATCH];
+    for(size_t start = 0; start < n; start += STATIC_BATCH){
+        size_t count = n - start < STATIC_BATCH ? n - start : STATIC_BATCH;
+        HashKeys64(key + start * key_size, key_size, count, sf->seed, hashes);
+        for(size_t i = 0; i < count; i++){
+            makeEdge(hashes[i], sf->length, sf->window, &edges[i]);
+            for(int j = 0; j < STATIC_ARITY; j++){
+                __builtin_prefetch(&sf->fingerprints[edges[i].slot[j]]);
+            }
+        }
+        uint64_t found = 0;
+        for(size_t i = 0; i < count; i++){
+            found |= (uint64_t)findEdge(sf->fingerprints, &edges[i]) << i;
+        }
+        result[start / STATIC_BATCH] = found;
+    }
+}
+
+uint64_t StaticSizeInBytes(const StaticFilter* sf){
+    return sf->length;
+}
+
+int SaveStaticFilter(const StaticFilter* sf, const char* path){
+    StaticFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, STATIC_FILE_MAGIC, sizeof(header.magic));
+    header.version = STATIC_FILE_VERSION;
+    header.hash_id = STATIC_HASH_MURMUR3_X64_128_FOLDED;
+    header.seed = sf->seed;
+    header.num_keys = sf->num_keys;
+    header.length = sf->length;
+    header.payload_offset = STATIC_FILE_PAYLOAD_OFFSET;
+    header.checksum = Checksum64(CHECKSUM64_BASIS, sf->fingerprints, sf->length);
+
+    FILE* file = fopen(path, "wb");
+    if(file == NULL){
+        printf("Could not open %s for writing!\n", path);
+        return -1;
+    }
+    char padding[STATIC_FILE_PAYLOAD_OFFSET] = {0};
+    memcpy(padding, &header, sizeof(header));
+    int ok = fwrite(padding, 1, sizeof(padding), file) == sizeof(padding) &&
+             fwrite(sf->fingerprints, 1, sf->length, file) == sf->length;
+    ok = (fclose(file) == 0) && ok;
+    if(!ok){
+        printf("Could not write %s!\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+StaticFilter* OpenStaticFilter(const char* path, int verify){
+    int fd = open(path, O_RDONLY);
+    if(fd < 0){
+        printf("Could not open %s!\n", path);
+        return NULL;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (uint64_t)st.st_size < STATIC_FILE_PAYLOAD_OFFSET){
+        printf("%s is not a static filter file!\n", path);
+        close(fd);
+        return NULL;
+    }
+    // Nothing writes to a static filter, so every process shares the page cache copy
+    void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED){
+        printf("Could not map %s!\n", path);
+        return NULL;
+    }
+
+    const StaticFileHeader* header = (const StaticFileHeader*)mapping;
+    if(memcmp(header->magic, STATIC_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+       header->version != STATIC_FILE_VERSION ||
+       header->hash_id != STATIC_HASH_MURMUR3_X64_128_FOLDED ||
+       header->payload_offset != STATIC_FILE_PAYLOAD_OFFSET ||
+       header->length <= STATIC_ARITY ||
+       header->payload_offset + header->length != (uint64_t)st.st_size){
+        printf("%s is not a static filter file!\n", path);
+        munmap(mapping, st.st_size);
+        return NULL;
+    }
+    uint8_t* fingerprints = (uint8_t*)mapping + header->payload_offset;
+    if(verify && Checksum64(CHECKSUM64_BASIS, fingerprints, header->length) != header->checksum){
+        printf("%s failed its checksum!\n", path);
+        munmap(mapping, st.st_size);
+        return NULL;
+    }
+    madvise(fingerprints, header->length, MADV_RANDOM);
+
+    StaticFilter* sf = newFilter(fingerprints, header->length, header->num_keys, header->seed);
+    if(sf == NULL){
+        munmap(mapping, st.st_size);
+        return NULL;
+    }
+    sf->mapping = mapping;
+    sf->mapping_size = st.st_size;
+    return sf;
+}
@@ -0,0 +1,87 @@
+#ifndef _STATIC_FILTER_
+#define _STATIC_FILTER_
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//-----------------------------------------------------------------------------
+
+// An immutable filter built once from the full key set, in the layout of
+// libfilter's static filter (filter/static.h): every key hashes to three
+// nearby slots of a byte array and is present when the XOR of the three bytes
+// equals its 8-bit fingerprint. That costs about 9 bits per key for an FPP of
+// 1/256, where a split block filter needs over 16. The payload can be probed
+// with libfilter_static_find_hash.
+
+typedef struct StaticFilter {
+    uint8_t *fingerprints;     // One byte per slot
+    uint64_t length;           // Number of slots (m)
+    uint64_t window;           // Slots a key's three probes are spread over
+    uint64_t num_keys;         // Distinct keys the filter was built from
+    uint32_t seed;             // Seed of the key hash
+    void *mapping;             // File mapping backing fingerprints, NULL when heap allocated
+    size_t mapping_size;
+    int (*CheckKey)(struct StaticFilter* sf, const void* str, size_t size);
+} StaticFilter;
+
+// Seed the builders hash keys with, for callers that hash keys themselves
+#define STATIC_FILTER_SEED 0x57a71c
+
+// Hands out the next key in *key and *size and returns 1, or returns 0 once the
+// keys run out. The key only has to stay valid until the next call.
+typedef int (*StaticKeyIterator)(void* ctx, const void** key, size_t* size);
+
+// Builds a filter from every key the iterator returns. Keys are copied a batch
+// at a time and hashed with the given number of threads. Returns NULL on error.
+StaticFilter* BuildStaticFilter(StaticKeyIterator next, void* ctx, int threads);
+// Same, over n fixed-size keys stored back to back in keys
+StaticFilter* BuildStaticFilterFromKeys(const void* keys, size_t key_size, size_t n, int threads);
+// Same, over HashKey64(key, size, STATIC_FILTER_SEED) of every key, like
+// libfilter_static_construct
+StaticFilter* BuildStaticFilterFromHashes(const uint64_t* hashes, size_t n);
+void DestroyStaticFilter(StaticFilter* sf);
+// Returns 0 when the key may be present and 1 when it is definitely absent
+int StaticCheckKey(StaticFilter* sf, const void* str, size_t size);
+// Sets bit i of result (n / 64 rounded up words) when key i may be present.
+// All three slots of each key in a batch are prefetched before any is read.
+void StaticCheckKeyBatch(StaticFilter* sf, const void* keys, size_t key_size, size_t n, uint64_t* result);
+uint64_t StaticSizeInBytes(const StaticFilter* sf);
+
+// On-disk format, laid out like the split block filter's: a header padded to
+// STATIC_FILE_PAYLOAD_OFFSET bytes, then the slots.
+#define STATIC_FILE_MAGIC "STAT"
+#define STATIC_FILE_VERSION 1
+#define STATIC_FILE_PAYLOAD_OFFSET 4096
+#define STATIC_HASH_MURMUR3_X64_128_FOLDED 1  // HashKey64
+
+typedef struct StaticFileHeader {
+    char magic[4];              // STATIC_FILE_MAGIC
+    uint32_t version;           // STATIC_FILE_VERSION
+    uint32_t hash_id;           // Hash function the keys were hashed with
+    uint32_t seed;              // Seed of that hash function
+    uint64_t num_keys;
+    uint64_t length;            // Slots in the payload, one byte each
+    uint64_t payload_offset;
+    uint64_t checksum;          // Checksum64 of the payload
+} StaticFileHeader;
+
+// Returns 0 on success and -1 on error
+int SaveStaticFilter(const StaticFilter* sf, const char* path);
+// Maps a saved filter read-only and serves lookups from the mapped pages.
+// When verify is non-zero the payload checksum is checked. Returns NULL on error.
+StaticFilter* OpenStaticFilter(const char* path, int verify);
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _STATIC_FILTER_
@@ -0,0 +1,583 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "vqf.h"
+#include "../hashing/hashing.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+// Compiled for these ISAs with target attributes and only called when the
+// running CPU has them, so this file needs no ISA flags
+#define AVX2 __attribute__((target("avx2")))
+#define BMI2 __attribute__((target("bmi2")))
+#define AVX2_BMI2 __attribute__((target("avx2,bmi2")))
+#endif
+
+// Keys per prefetch batch
+#define VQF_BATCH 64
+// Fraction of the entries in use when a filter sized for n keys holds n
+#define VQF_LOAD 0.9
+// A tail with no kept bits left: just the terminating 1
+#define VQF_EMPTY_TAIL (1u << VQF_TAIL_BITS)
+// Doublings to try when the entries of a full filter do not fit in one of
+// twice the size
+#define VQF_MAX_GROWTH 4
+// Largest filter, 2^40 lines
+#define VQF_MAX_LOG_LINES 40
+// Below this fraction of its entries in use, two full lines for a key point to
+// entries that all share its prefix rather than to a full filter. A doubling
+// would move them on together, so the filter does not grow.
+#define VQF_MIN_GROW_LOAD 0.5
+
+// Salt of the two permutations, from the vendored C++ filter
+static const uint64_t entropy[8] = {
+    0xb15dbfc96a694e83, 0x52837326421249c7, 0x50a38b0aec7c4baa, 0x5e71de01da7842e0,
+    0xc675b743f7c74fae, 0x42d64f9d750b46b5, 0xa6fafa9aac5d4c8b, 0xf394f37b5e4c4972};
+
+// Bits of the hash prefix that the permutations turn into line, bucket and
+// fingerprint
+static inline int addressBits(int log_lines){
+    return log_lines + 5 + VQF_FINGERPRINT_BITS;
+}
+
+static inline uint64_t prefixOf(const VectorQuotientFilter* vqf, uint64_t hash){
+    return hash >> (64 - addressBits(vqf->log_lines));
+}
+
+// The VQF_TAIL_BITS hash bits after the prefix, followed by a 1. As bits move
+// into the address the tail shifts left, so the 1 always marks where the kept
+// bits end.
+static inline unsigned tailOf(const VectorQuotientFilter* vqf, uint64_t hash){
+    unsigned bits = (hash >> (64 - addressBits(vqf->log_lines) - VQF_TAIL_BITS)) & ((1u << VQF_TAIL_BITS) - 1);
+    return (bits << 1) | 1;
+}
+
+// Where a key goes for one of its two choices, and the entry it is stored as:
+// the choice bit, the fingerprint, then the tail
+typedef struct {
+    VqfLine* line;
+    int bucket;
+    uint16_t entry;
+} Slot;
+
+static inline void locate(const VectorQuotientFilter* vqf, int choice, uint64_t prefix, unsigned tail, Slot* s){
+    uint64_t x = libfilter_feistel_permute_forward(&vqf->feistel[choice], addressBits(vqf->log_lines), prefix);
+    s->line = vqf->lines + (x >> (5 + VQF_FINGERPRINT_BITS));
+    s->bucket = (int)(x >> VQF_FINGERPRINT_BITS) & (VQF_BUCKETS - 1);
+    s->entry = (uint16_t)((choice << 15) | ((x & ((1u << VQF_FINGERPRINT_BITS) - 1)) << (VQF_TAIL_BITS + 1)) | tail);
+}
+
+// A stored entry matches when everything above its terminating 1 equals the
+// wanted entry; a shorter tail compares fewer bits
+static inline int entryMatches(uint16_t stored, uint16_t wanted){
+    unsigned low = stored & (0u - stored);
+    return ((stored ^ wanted) & ~((low << 1) - 1) & 0xffff) == 0;
+}
+
+//-----------------------------------------------------------------------------
+// Lines
+
+static inline int population(const VqfLine* line){
+    return 64 - __builtin_clzll(line->metadata) - VQF_BUCKETS;
+}
+
+#if defined(__x86_64__)
+BMI2 static inline void bucketBoundsBmi2(uint64_t metadata, int bucket, int* begin, int* end){
+    // The ones ending the previous bucket and this one
+    uint64_t ends = _pdep_u64(bucket == 0 ? 1 : 3ULL << (bucket - 1), metadata);
+    *end = 63 - __builtin_clzll(ends) - bucket;
+    *begin = bucket == 0 ? 0 : __builtin_ctzll(ends) + 1 - bucket;
+}
+#endif
+
+// The entries of a bucket are entries[begin, end): a bucket's entries sit
+// between the 1 ending the bucket before and its own
+static inline void bucketBounds(uint64_t metadata, int bucket, int* begin, int* end){
+#if defined(__x86_64__)
+    if(__builtin_cpu_supports("bmi2")){
+        bucketBoundsBmi2(metadata, bucket, begin, end);
+        return;
+    }
+#endif
+    int before = -1;
+    for(int i = 0; i < bucket; i++){
+        before = __builtin_ctzll(metadata);
+        metadata &= metadata - 1;
+    }
+    *begin = before + 1 - bucket;
+    *end = __builtin_ctzll(metadata) - bucket;
+}
+
+static int lineInsert(VqfLine* line, int bucket, uint16_t entry){
+    if(population(line) == VQF_LINE_ENTRIES){
+        return -1;
+    }
+    int begin, end;
+    bucketBounds(line->metadata, bucket, &begin, &end);
+    memmove(&line->entries[end + 1], &line->entries[end], (VQF_LINE_ENTRIES - 1 - end) * sizeof(uint16_t));
+    line->entries[end] = entry;
+    // A 0 for the entry goes just before the 1 ending the bucket
+    int position = end + bucket;
+    line->metadata = (line->metadata & ((1ULL << position) - 1)) | (line->metadata >> position << (position + 1));
+    return 0;
+}
+
+static void lineRemove(VqfLine* line, int bucket, int index){
+    memmove(&line->entries[index], &line->entries[index + 1], (VQF_LINE_ENTRIES - 1 - index) * sizeof(uint16_t));
+    int position = index + bucket;
+    line->metadata = (line->metadata & ((1ULL << position) - 1)) | (line->metadata >> (position + 1) << position);
+}
+
+#if defined(__x86_64__)
+// Two bits per entry, set when it matches wanted, for every entry in the line
+// at once. The line is 32 16-bit lanes, the first four being the metadata.
+AVX2 static inline uint64_t lineMatchesAvx2(const VqfLine* line, uint16_t wanted){
+    __m256i w = _mm256_set1_epi16((short)wanted);
+    __m256i one = _mm256_set1_epi16(1);
+    __m256i zero = _mm256_setzero_si256();
+    uint64_t matches = 0;
+    for(int half = 0; half < 2; half++){
+        __m256i v = _mm256_load_si256((const __m256i*)line + half);
+        __m256i low = _mm256_and_si256(v, _mm256_sub_epi16(zero, v));
+        __m256i ignored = _mm256_sub_epi16(_mm256_slli_epi16(low, 1), one);
+        __m256i diff = _mm256_andnot_si256(ignored, _mm256_xor_si256(v, w));
+        matches |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(diff, zero)) << (32 * half);
+    }
+    return matches >> (2 * (sizeof(uint64_t) / sizeof(uint16_t)));
+}
+
+AVX2_BMI2 static inline int lineFindAvx2(const VqfLine* line, int bucket, uint16_t wanted){
+    int begin, end;
+    bucketBoundsBmi2(line->metadata, bucket, &begin, &end);
+    uint64_t range = ((1ULL << (2 * end)) - 1) & ~((1ULL << (2 * begin)) - 1);
+    return (lineMatchesAvx2(line, wanted) & range) != 0;
+}
+
+AVX2_BMI2 static uint64_t findSlotsAvx2(Slot (*slots)[2], size_t count){
+    uint64_t found = 0;
+    for(size_t i = 0; i < count; i++){
+        const Slot* s = slots[i];
+        found |= (uint64_t)(lineFindAvx2(s[0].line, s[0].bucket, s[0].entry) ||
+                            lineFindAvx2(s[1].line, s[1].bucket, s[1].entry)) << i;
+    }
+    return found;
+}
+#endif
+
+static inline int lineFind(const VqfLine* line, int bucket, uint16_t wanted){
+    int begin, end;
+    bucketBounds(line->metadata, bucket, &begin, &end);
+    for(int i = begin; i < end; i++){
+        if(entryMatches(line->entries[i], wanted)){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Sets bit i of the result when the key of slots[i] may be present, for up to
+// 64 keys. The CPU is checked once per call rather than once per line.
+static uint64_t findSlots(Slot (*slots)[2], size_t count){
+#if defined(__x86_64__)
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2")){
+        return findSlotsAvx2(slots, count);
+    }
+#endif
+    uint64_t found = 0;
+    for(size_t i = 0; i < count; i++){
+        const Slot* s = slots[i];
+        found |= (uint64_t)(lineFind(s[0].line, s[0].bucket, s[0].entry) ||
+                            lineFind(s[1].line, s[1].bucket, s[1].entry)) << i;
+    }
+    return found;
+}
+
+static VqfLine* allocLines(int log_lines){
+    uint64_t count = 1ULL << log_lines;
+    VqfLine* lines = (VqfLine*)aligned_alloc(64, count * sizeof(VqfLine));
+    if(lines == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    memset(lines, 0, count * sizeof(VqfLine));
+    for(uint64_t i = 0; i < count; i++){
+        lines[i].metadata = (1ULL << VQF_BUCKETS) - 1;
+    }
+    return lines;
+}
+
+//-----------------------------------------------------------------------------
+// Insert and grow
+
+// Stores the entry in the emptier of the prefix's two lines
+static int putPrefix(VectorQuotientFilter* vqf, uint64_t prefix, unsigned tail){
+    Slot s[2];
+    locate(vqf, 0, prefix, tail, &s[0]);
+    locate(vqf, 1, prefix, tail, &s[1]);
+    int choice = population(s[0].line) > population(s[1].line);
+    if(lineInsert(s[choice].line, s[choice].bucket, s[choice].entry) != 0){
+        return -1;
+    }
+    vqf->occupancy++;
+    return 0;
+}
+
+// Puts an entry of a filter extra doublings smaller into to: each doubling
+// moves the first kept bit into the prefix, and a tail that has none left goes
+// in under both possible bits
+static int reinsert(VectorQuotientFilter* to, uint64_t prefix, unsigned tail, int extra){
+    if(extra == 0){
+        return putPrefix(to, prefix, tail);
+    }
+    if(tail != VQF_EMPTY_TAIL){
+        unsigned bit = (tail >> VQF_TAIL_BITS) & 1;
+        return reinsert(to, (prefix << 1) | bit, (tail << 1) & ((2u << VQF_TAIL_BITS) - 1), extra - 1);
+    }
+    if(reinsert(to, prefix << 1, tail, extra - 1) != 0){
+        return -1;
+    }
+    return reinsert(to, (prefix << 1) | 1, tail, extra - 1);
+}
+
+static int moveEntries(const VectorQuotientFilter* from, VectorQuotientFilter* to){
+    int bits = addressBits(from->log_lines);
+    int extra = to->log_lines - from->log_lines;
+    for(uint64_t l = 0; l < (1ULL << from->log_lines); l++){
+        const VqfLine* line = &from->lines[l];
+        int count = population(line);
+        uint64_t bucket = 0;
+        for(int bit = 0, index = 0; index < count; bit++){
+            if((line->metadata >> bit) & 1){
+                bucket++;
+                continue;
+            }
+            uint16_t entry = line->entries[index++];
+            int choice = entry >> 15;
+            uint64_t x = (((l << 5) | bucket) << VQF_FINGERPRINT_BITS) |
+                         ((entry >> (VQF_TAIL_BITS + 1)) & ((1u << VQF_FINGERPRINT_BITS) - 1));
+            uint64_t prefix = libfilter_feistel_permute_backward(&from->feistel[choice], bits, x);
+            if(reinsert(to, prefix, entry & ((2u << VQF_TAIL_BITS) - 1), extra) != 0){
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Doubles the filter, or grows it further in the rare case that its entries do
+// not fit twice the size
+static int grow(VectorQuotientFilter* vqf){
+    if(vqf->occupancy < (double)(VQF_LINE_ENTRIES << vqf->log_lines) * VQF_MIN_GROW_LOAD){
+        printf("Too many copies of one key in the vector quotient filter!\n");
+        return -1;
+    }
+    for(int up = 1; up <= VQF_MAX_GROWTH && vqf->log_lines + up <= VQF_MAX_LOG_LINES; up++){
+        VectorQuotientFilter bigger = *vqf;
+        bigger.log_lines = vqf->log_lines + up;
+        bigger.occupancy = 0;
+        bigger.lines = allocLines(bigger.log_lines);
+        if(bigger.lines == NULL){
+            return -1;
+        }
+        if(moveEntries(vqf, &bigger) == 0){
+            free(vqf->lines);
+            vqf->lines = bigger.lines;
+            vqf->log_lines = bigger.log_lines;
+            vqf->occupancy = bigger.occupancy;
+            return 0;
+        }
+        free(bigger.lines);
+    }
+    printf("Could not grow the vector quotient filter!\n");
+    return -1;
+}
+
+// Entries in the key's buckets that match it, up to VQF_MAX_COPIES
+static int countCopies(const VectorQuotientFilter* vqf, uint64_t hash){
+    uint64_t prefix = prefixOf(vqf, hash);
+    unsigned tail = tailOf(vqf, hash);
+    int copies = 0;
+    for(int choice = 0; choice < 2 && copies < VQF_MAX_COPIES; choice++){
+        Slot s;
+        locate(vqf, choice, prefix, tail, &s);
+        int begin, end;
+        bucketBounds(s.line->metadata, s.bucket, &begin, &end);
+        for(int i = begin; i < end && copies < VQF_MAX_COPIES; i++){
+            copies += entryMatches(s.line->entries[i], s.entry);
+        }
+    }
+    return copies;
+}
+
+static int putHash(VectorQuotientFilter* vqf, uint64_t hash){
+    // Further copies would only fill the key's two lines, which no doubling
+    // can empty as the copies move on together
+    if(countCopies(vqf, hash) == VQF_MAX_COPIES){
+        return 0;
+    }
+    while(putPrefix(vqf, prefixOf(vqf, hash), tailOf(vqf, hash)) != 0){
+        if(grow(vqf) != 0){
+            return -1;
+        }
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+static VectorQuotientFilter* newFilter(int log_lines){
+    VectorQuotientFilter* vqf = (VectorQuotientFilter*)malloc(sizeof(VectorQuotientFilter));
+    if(vqf == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    vqf->log_lines = log_lines;
+    vqf->occupancy = 0;
+    vqf->feistel[0] = libfilter_feistel_create(&entropy[0]);
+    vqf->feistel[1] = libfilter_feistel_create(&entropy[4]);
+    vqf->lines = NULL;
+    vqf->Put = VqfPut;
+    vqf->Delete = VqfDelete;
+    vqf->Check = VqfCheck;
+    return vqf;
+}
+
+VectorQuotientFilter* createVectorQuotientFilter(long int n){
+    int log_lines = 0;
+    while(log_lines < VQF_MAX_LOG_LINES && (double)(VQF_LINE_ENTRIES << log_lines) * VQF_LOAD < n){
+        log_lines++;
+    }
+    VectorQuotientFilter* vqf = newFilter(log_lines);
+    if(vqf == NULL){
+        return NULL;
+    }
+    vqf->lines = allocLines(log_lines);
+    if(vqf->lines == NULL){
+        free(vqf);
+        return NULL;
+    }
+    return vqf;
+}
+
+void DestroyVectorQuotientFilter(VectorQuotientFilter* vqf){
+    free(vqf->lines);
+    free(vqf);
+}
+
+static void locateBoth(const VectorQuotientFilter* vqf, uint64_t hash, Slot s[2]){
+    uint64_t prefix = prefixOf(vqf, hash);
+    unsigned tail = tailOf(vqf, hash);
+    locate(vqf, 0, prefix, tail, &s[0]);
+    locate(vqf, 1, prefix, tail, &s[1]);
+}
+
+static int checkHash(VectorQuotientFilter* vqf, uint64_t hash){
+    Slot s[1][2];
+    locateBoth(vqf, hash, s[0]);
+    return (int)findSlots(s, 1);
+}
+
+// Removes the matching entry that kept the most bits, so that an entry standing
+// for other keys as well is the last to go
+static int deleteHash(VectorQuotientFilter* vqf, uint64_t hash){
+    uint64_t prefix = prefixOf(vqf, hash);
+    unsigned tail = tailOf(vqf, hash);
+    Slot best;
+    int best_index = -1;
+    unsigned best_low = 0;
+    for(int choice = 0; choice < 2; choice++){
+        Slot s;
+        locate(vqf, choice, prefix, tail, &s);
+        int begin, end;
+        bucketBounds(s.line->metadata, s.bucket, &begin, &end);
+        for(int i = begin; i < end; i++){
+            uint16_t stored = s.line->entries[i];
+            unsigned low = stored & (0u - stored);
+            if(entryMatches(stored, s.entry) && (best_index < 0 || low < best_low)){
+                best = s;
+                best_index = i;
+                best_low = low;
+            }
+        }
+    }
+    if(best_index < 0){
+        return 1;
+    }
+    lineRemove(best.line, best.bucket, best_index);
+    vqf->occupancy--;
+    return 0;
+}
+
+int VqfPut(VectorQuotientFilter* vqf, const void* str, size_t size){
+    return putHash(vqf, HashKey64(str, size, VQF_SEED));
+}
+
+int VqfDelete(VectorQuotientFilter* vqf, const void* str, size_t size){
+    return deleteHash(vqf, HashKey64(str, size, VQF_SEED));
+}
+
+int VqfCheck(VectorQuotientFilter* vqf, const void* str, size_t size){
+    return !checkHash(vqf, HashKey64(str, size, VQF_SEED));
+}
+
+static void prefetchLines(const VectorQuotientFilter* vqf, uint64_t hash){
+    uint64_t prefix = prefixOf(vqf, hash);
+    for(int choice = 0; choice < 2; choice++){
+        uint64_t x = libfilter_feistel_permute_forward(&vqf->feistel[choice], addressBits(vqf->log_lines), prefix);
+        __builtin_prefetch(vqf->lines + (x >> (5 + VQF_FINGERPRINT_BITS)));
+    }
+}
+
+size_t VqfPutBatch(VectorQuotientFilter* vqf, const void* keys, size_t key_size, size_t n){
+    const char* key = (const char*)keys;
+    uint64_t hashes[VQF_BATCH];
+    for(size_t start = 0; start < n; start += VQF_BATCH){
+        size_t count = n - start < VQF_BATCH ? n - start : VQF_BATCH;
+        HashKeys64(key + start * key_size, key_size, count, VQF_SEED, hashes);
+        for(size_t i = 0; i < count; i++){
+            prefetchLines(vqf, hashes[i]);
+        }
+        for(size_t i = 0; i < count; i++){
+            if(putHash(vqf, hashes[i]) != 0){
+                return start + i;
+            }
+        }
+    }
+    return n;
+}
+
+void VqfDeleteBatch(VectorQuotientFilter* vqf, const void* keys, size_t key_size, size_t n){
+    const char* key = (const char*)keys;
+    uint64_t hashes[VQF_BATCH];
+    for(size_t start = 0; start < n; start += VQF_BATCH){
+        size_t count = n - start < VQF_BATCH ? n - start : VQF_BATCH;
+        HashKeys64(key + start * key_size, key_size, count, VQF_SEED, hashes);
+        for(size_t i = 0; i < count; i++){
+            prefetchLines(vqf, hashes[i]);
+        }
+        for(size_t i = 0; i < count; i++){
+            deleteHash(vqf, hashes[i]);
+        }
+    }
+}
+
+void VqfCheckBatch(VectorQuotientFilter* vqf, const void* keys, size_t key_size, size_t n, uint64_t* result){
+    const char* key = (const char*)keys;
+    uint64_t hashes[VQF_BATCH];
+    Slot slots[VQF_BATCH][2];
+    for(size_t start = 0; start < n; start += VQF_BATCH){
+        size_t count = n - start < VQF_BATCH ? n - start : VQF_BATCH;
+        HashKeys64(key + start * key_size, key_size, count, VQF_SEED, hashes);
+        for(size_t i = 0; i < count; i++){
+            locateBoth(vqf, hashes[i], slots[i]);
+            __builtin_prefetch(slots[i][0].line);
+            __builtin_prefetch(slots[i][1].line);
+        }
+        result[start / VQF_BATCH] = findSlots(slots, count);
+    }
+}
+
+uint64_t VqfSizeInBytes(const VectorQuotientFilter* vqf){
+    return sizeof(VqfLine) << vqf->log_lines;
+}
+
+// An absent key is compared against the entries of one bucket per choice, and
+// an entry matches it with probability 2^-(fingerprint bits + kept bits)
+double VqfFpp(const VectorQuotientFilter* vqf){
+    double sum = 0;
+    for(uint64_t l = 0; l < (1ULL << vqf->log_lines); l++){
+        const VqfLine* line = &vqf->lines[l];
+        for(int i = 0; i < population(line); i++){
+            int kept = VQF_TAIL_BITS - __builtin_ctz(line->entries[i]);
+            sum += ldexp(1.0, -(VQF_FINGERPRINT_BITS + kept));
+        }
+    }
+    return sum / ((double)VQF_BUCKETS * (1ULL << vqf->log_lines));
+}
+
+//-----------------------------------------------------------------------------
+// Files
+
+int SaveVectorQuotientFilter(const VectorQuotientFilter* vqf, const char* path){
+    uint64_t bytes = VqfSizeInBytes(vqf);
+    VqfFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, VQF_FILE_MAGIC, sizeof(header.magic));
+    header.version = VQF_FILE_VERSION;
+    header.hash_id = VQF_HASH_MURMUR3_X64_128_FOLDED;
+    header.seed = VQF_SEED;
+    header.log_lines = vqf->log_lines;
+    header.occupancy = vqf->occupancy;
+    memcpy(header.feistel[0], vqf->feistel[0].keys, sizeof(header.feistel[0]));
+    memcpy(header.feistel[1], vqf->feistel[1].keys, sizeof(header.feistel[1]));
+    header.payload_offset = VQF_FILE_PAYLOAD_OFFSET;
+    header.payload_bytes = bytes;
+    header.checksum = Checksum64(CHECKSUM64_BASIS, vqf->lines, bytes);
+
+    FILE* file = fopen(path, "wb");
+    if(file == NULL){
+        printf("Could not open %s for writing!\n", path);
+        return -1;
+    }
+    char padding[VQF_FILE_PAYLOAD_OFFSET] = {0};
+    memcpy(padding, &header, sizeof(header));
+    int ok = fwrite(padding, 1, sizeof(padding), file) == sizeof(padding) &&
+             fwrite(vqf->lines, 1, bytes, file) == bytes;
+    ok = (fclose(file) == 0) && ok;
+    if(!ok){
+        printf("Could not write %s!\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+VectorQuotientFilter* OpenVectorQuotientFilter(const char* path, int verify){
+    FILE* file = fopen(path, "rb");
+    if(file == NULL){
+        printf("Could not open %s!\n", path);
+        return NULL;
+    }
+    VqfFileHeader header;
+    if(fread(&header, sizeof(header), 1, file) != 1 ||
+       memcmp(header.magic, VQF_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+       header.version != VQF_FILE_VERSION ||
+       header.hash_id != VQF_HASH_MURMUR3_X64_128_FOLDED ||
+       header.seed != VQF_SEED ||
+       header.log_lines > VQF_MAX_LOG_LINES ||
+       header.payload_offset != VQF_FILE_PAYLOAD_OFFSET ||
+       header.payload_bytes != sizeof(VqfLine) << header.log_lines){
+        printf("%s is not a vector quotient filter file!\n", path);
+        fclose(file);
+        return NULL;
+    }
+    VectorQuotientFilter* vqf = newFilter((int)header.log_lines);
+    if(vqf == NULL){
+        fclose(file);
+        return NULL;
+    }
+    vqf->occupancy = header.occupancy;
+    memcpy(vqf->feistel[0].keys, header.feistel[0], sizeof(header.feistel[0]));
+    memcpy(vqf->feistel[1].keys, header.feistel[1], sizeof(header.feistel[1]));
+    vqf->lines = (VqfLine*)aligned_alloc(64, header.payload_bytes);
+    if(vqf->lines == NULL){
+        printf("Memory Not allocated!\n");
+        fclose(file);
+        free(vqf);
+        return NULL;
+    }
+    int ok = fseek(file, (long)header.payload_offset, SEEK_SET) == 0 &&
+             fread(vqf->lines, 1, header.payload_bytes, file) == header.payload_bytes;
+    fclose(file);
+    if(!ok){
+        printf("Could not read %s!\n", path);
+        DestroyVectorQuotientFilter(vqf);
+        return NULL;
+    }
+    if(verify && Checksum64(CHECKSUM64_BASIS, vqf->lines, header.payload_bytes) != header.checksum){
+        printf("%s failed its checksum!\n", path);
+        DestroyVectorQuotientFilter(vqf);
+        return NULL;
+    }
+    return vqf;
+}
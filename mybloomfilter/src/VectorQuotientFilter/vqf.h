@@ -0,0 +1,120 @@
+#ifndef _VQF_
+#define _VQF_
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include "filter/util.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//-----------------------------------------------------------------------------
+
+// A growable vector quotient filter, after libfilter's TaffyVectorQuotientFilter
+// (filter/taffy-vector-quotient.hpp). Every key picks the emptier of two 64-byte
+// lines, each holding 28 16-bit entries sorted into 32 buckets by a 64-bit
+// occupancy word, so a lookup touches two cache lines and compares the entries
+// of one bucket in each, all at once with AVX2 and BMI2 when the running CPU
+// has them.
+//
+// A key's line, bucket and 9-bit fingerprint are a Feistel permutation of a
+// prefix of its hash, and the entry also keeps the next up to 5 hash bits. When
+// both lines are full the filter doubles: every entry is inverted back to its
+// hash prefix, which moves one kept bit into the address. An entry with no bits
+// left is inserted into both halves, so the FPP slowly rises once the filter
+// has doubled five times past the size its keys were inserted at; sizing it
+// for the expected key count avoids that.
+//
+// The vendored C++ header is not wrapped directly: its lookups miss keys that
+// were inserted, and it has no delete or file format.
+
+#define VQF_LINE_ENTRIES 28
+#define VQF_BUCKETS 32
+#define VQF_FINGERPRINT_BITS 9
+#define VQF_TAIL_BITS 5
+// Copies of one key the filter keeps
+#define VQF_MAX_COPIES 8
+
+typedef struct VqfLine {
+    uint64_t metadata;         // A 0 per entry and a 1 ending each bucket, from the low bit
+    uint16_t entries[VQF_LINE_ENTRIES]; // Choice bit, fingerprint, then the kept hash bits
+} VqfLine;
+
+typedef struct VectorQuotientFilter {
+    VqfLine *lines;            // 64-byte aligned
+    int log_lines;             // log2 of the number of lines
+    uint64_t occupancy;        // Entries in use
+    libfilter_feistel feistel[2]; // One permutation per line choice
+    int (*Put)(struct VectorQuotientFilter* vqf, const void* str, size_t size);
+    int (*Delete)(struct VectorQuotientFilter* vqf, const void* str, size_t size);
+    int (*Check)(struct VectorQuotientFilter* vqf, const void* str, size_t size);
+} VectorQuotientFilter;
+
+// Seed of the key hash
+#define VQF_SEED 0x7a9f
+
+// Sized to take n keys before its first doubling
+VectorQuotientFilter* createVectorQuotientFilter(long int n);
+void DestroyVectorQuotientFilter(VectorQuotientFilter* vqf);
+// Returns 0 on success and -1 when the filter is full and cannot grow, in
+// which case the key is not added. A key already put VQF_MAX_COPIES times is
+// not added again but still succeeds, so that many deletes remove it.
+int VqfPut(VectorQuotientFilter* vqf, const void* str, size_t size);
+// Removes one earlier Put of the key and returns 0, or returns 1 when the
+// filter can tell the key is absent. Deleting a key that was never put can
+// cause false negatives for other keys. A key whose entry was copied into
+// both halves by a doubling leaves the other copy behind, which costs FPP but
+// never a false negative.
+int VqfDelete(VectorQuotientFilter* vqf, const void* str, size_t size);
+// Returns 0 when the key may be present and 1 when it is definitely absent
+int VqfCheck(VectorQuotientFilter* vqf, const void* str, size_t size);
+// Batch forms over n fixed-size keys stored back to back in keys. Keys are
+// hashed a batch at a time and both lines of every key are prefetched before
+// any is touched. The put returns the number of keys added, stopping at the
+// first that cannot be.
+size_t VqfPutBatch(VectorQuotientFilter* vqf, const void* keys, size_t key_size, size_t n);
+void VqfDeleteBatch(VectorQuotientFilter* vqf, const void* keys, size_t key_size, size_t n);
+// Sets bit i of result (n / 64 rounded up words) when key i may be present
+void VqfCheckBatch(VectorQuotientFilter* vqf, const void* keys, size_t key_size, size_t n, uint64_t* result);
+uint64_t VqfSizeInBytes(const VectorQuotientFilter* vqf);
+// Expected FPP, from the hash bits every entry keeps. Reads the whole filter.
+double VqfFpp(const VectorQuotientFilter* vqf);
+
+// On-disk format, laid out like the split block filter's: a header padded to
+// VQF_FILE_PAYLOAD_OFFSET bytes, then the lines in native byte order.
+#define VQF_FILE_MAGIC "TVQF"
+#define VQF_FILE_VERSION 1
+#define VQF_FILE_PAYLOAD_OFFSET 4096
+#define VQF_HASH_MURMUR3_X64_128_FOLDED 1  // HashKey64
+
+typedef struct VqfFileHeader {
+    char magic[4];              // VQF_FILE_MAGIC
+    uint32_t version;           // VQF_FILE_VERSION
+    uint32_t hash_id;           // Hash function the keys were hashed with
+    uint32_t seed;              // Seed of that hash function
+    uint32_t log_lines;
+    uint32_t reserved;
+    uint64_t occupancy;
+    uint64_t feistel[2][2][2];  // Keys of both permutations
+    uint64_t payload_offset;
+    uint64_t payload_bytes;
+    uint64_t checksum;          // Checksum64 of the payload
+} VqfFileHeader;
+
+// Returns 0 on success and -1 on error
+int SaveVectorQuotientFilter(const VectorQuotientFilter* vqf, const char* path);
+// Reads a saved filter into memory, where it can keep growing. When verify is
+// non-zero the payload checksum is checked. Returns NULL on error.
+VectorQuotientFilter* OpenVectorQuotientFilter(const char* path, int verify);
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _VQF_
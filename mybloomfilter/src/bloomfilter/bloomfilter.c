@@ -4,36 +4,61 @@
 // #include <murmur3.h>
 #include "../murmur3/murmur3.h"
 #include "bloomfilter.h"
+#include "../parallel/parallel_build.h"
 #include <math.h>
 
-BloomFilter* createBloomFilter(int n, double p){
+BloomFilter* createBloomFilter(long int n, double p){
     BloomFilter* bf = (BloomFilter*)malloc(sizeof(BloomFilter));
+    if(bf == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
 
-    bf->size = (int) ceil((-n * log(p)) / (log(2) * log(2)));
+    bf->size = (uint64_t) ceil((-n * log(p)) / (log(2) * log(2)));
     bf->hash_count = (int) ceil((bf->size / (double)n) * log(2));
-    bf->bit_array = (unsigned char *) calloc(bf->size, sizeof(unsigned char));
+    bf->num_words = (bf->size + 63) / 64;
+    bf->bit_array = (uint64_t *) calloc(bf->num_words, sizeof(uint64_t));
+    if(bf->bit_array == NULL){
+        printf("Memory Not allocated!\n");
+        free(bf);
+        return NULL;
+    }
     bf->Put = Put;
     bf->Check = Check;
+    bf->FillRatio = FillRatio;
+    bf->BuildFromKeys = BloomFilterBuildFromKeys;
     return bf;
 }
 
+// Maps a 64-bit hash onto [0, size) with a multiply-shift instead of a modulo
+static inline uint64_t reduce(uint64_t hash, uint64_t size){
+    return (uint64_t)(((unsigned __int128)hash * size) >> 64);
+}
+
+// All k probe positions come from one 128-bit hash as h1 + i*h2
+// (Kirsch-Mitzenmacher), so each key is hashed once regardless of k.
+static inline void hashKey(const void* str, size_t size, uint64_t hash[2]){
+    uint32_t seed = 40*40;            /* Seed value for hash */
+    MurmurHash3_x64_128(str, size, seed, hash);
+}
+
 void Put(BloomFilter* bf, const void* str, size_t size){
-    for(int i = 40; i<bf->hash_count + 40; i++){
-        uint32_t hash;                /* Output for the hash */
-        uint32_t seed = i*i;              /* Seed value for hash */
-        MurmurHash3_x86_32(str, size, seed, &hash);
-        bf->bit_array[(int)(hash % bf->size)] = 1;
-        // printf("%d\n", (int)(hash % bf->size));
+    uint64_t hash[2];
+    hashKey(str, size, hash);
+    for(int i = 0; i<bf->hash_count; i++){
+        uint64_t pos = reduce(hash[0] + i * hash[1], bf->size);
+        bf->bit_array[pos >> 6] |= (uint64_t)1 << (pos & 63);
+        // printf("%lu\n", pos);
     }
 }
 
 int Check(BloomFilter* bf, const void* str, size_t size){
     int flag = 0;
-    for(int i = 40; i<bf->hash_count + 40; i++){
-        uint32_t hash;
-        uint32_t seed = i*i;
-        MurmurHash3_x86_32(str, size, seed, &hash);
-        if(bf->bit_array[(int)(hash % bf->size)] == 0){
+    uint64_t hash[2];
+    hashKey(str, size, hash);
+    for(int i = 0; i<bf->hash_count; i++){
+        uint64_t pos = reduce(hash[0] + i * hash[1], bf->size);
+        if((bf->bit_array[pos >> 6] & ((uint64_t)1 << (pos & 63))) == 0){
             flag = 1;
             break;
         }
@@ -41,6 +66,44 @@ int Check(BloomFilter* bf, const void* str, size_t size){
     return flag;
 }
 
+double FillRatio(BloomFilter* bf){
+    uint64_t bits_set = 0;
+    for(uint64_t i = 0; i < bf->num_words; i++){
+        bits_set += __builtin_popcountll(bf->bit_array[i]);
+    }
+    return bits_set / (double)bf->size;
+}
+
+static size_t bloomExpand(void* ctx, const void* keys, size_t key_size, size_t n, uint64_t* out){
+    BloomFilter* bf = (BloomFilter*)ctx;
+    const char* key = (const char*)keys;
+    size_t count = 0;
+    for(size_t i = 0; i < n; i++){
+        uint64_t hash[2];
+        hashKey(key + i * key_size, key_size, hash);
+        for(int j = 0; j < bf->hash_count; j++){
+            out[count++] = reduce(hash[0] + j * hash[1], bf->size);
+        }
+    }
+    return count;
+}
+
+static uint64_t bloomUnit(void* ctx, uint64_t pos){
+    return pos >> 6;
+}
+
+static void bloomApply(void* ctx, const uint64_t* positions, size_t n){
+    BloomFilter* bf = (BloomFilter*)ctx;
+    for(size_t i = 0; i < n; i++){
+        bf->bit_array[positions[i] >> 6] |= (uint64_t)1 << (positions[i] & 63);
+    }
+}
+
+void BloomFilterBuildFromKeys(BloomFilter* bf, const void* keys, size_t key_size, size_t n, int threads){
+    ParallelBuildOps ops = {bloomExpand, bloomUnit, bloomApply, bf->num_words, bf->hash_count};
+    ParallelBuild(&ops, bf, keys, key_size, n, threads);
+}
+
 // int main(){
 //     int n;
 //     double p;
@@ -10,16 +10,25 @@ extern "C" {
 #include <stdint.h>
 #include <stddef.h>
 typedef struct BloomFilter{
-    unsigned char *bit_array;  // Bit array to store filter data
-    int size;                  // Size of the bit array (m)
+    uint64_t *bit_array;       // Packed bit array, 64 bits per word
+    uint64_t size;             // Size of the bit array in bits (m)
+    uint64_t num_words;        // Number of 64-bit words in bit_array
     int hash_count;             // Number of hash functions (k)
     void (*Put)(struct BloomFilter* bf, const void* str, size_t size);
     int (*Check)(struct BloomFilter* bf, const void* str, size_t size);
+    double (*FillRatio)(struct BloomFilter* bf);
+    void (*BuildFromKeys)(struct BloomFilter* bf, const void* keys, size_t key_size, size_t n, int threads);
 } BloomFilter;
 
-BloomFilter* createBloomFilter(int n, double p);
+BloomFilter* createBloomFilter(long int n, double p);
 void Put(BloomFilter* bf, const void* str, size_t size);
 int Check(BloomFilter* bf, const void* str, size_t size);
+// Fraction of the m bits that are set, counted with popcount over the words
+double FillRatio(BloomFilter* bf);
+// Bulk inserts n fixed-size keys with the given number of threads. Probe
+// positions are radix-partitioned by word range so each thread sets bits in its
+// own slice of the array; the result is bit-identical to calling Put per key.
+void BloomFilterBuildFromKeys(BloomFilter* bf, const void* keys, size_t key_size, size_t n, int threads);
 
 
 //-----------------------------------------------------------------------------
@@ -28,4 +37,4 @@ int Check(BloomFilter* bf, const void* str, size_t size);
 }
 #endif
 
-#endif // _BLOOMFILTER_H_
\ No newline at end of file
+#endif // _BLOOMFILTER_H_
@@ -0,0 +1,871 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "filter.h"
+#include "../bloomfilter/bloomfilter.h"
+#include "../SplitBlockBloomFilter/sbbf.h"
+#include "../BlockedBloomFilter/bbf.h"
+#include "../GrowableBloomFilter/gbf.h"
+#include "../CountingBloomFilter/cbf.h"
+#include "../StaticFilter/static_filter.h"
+#include "../BinaryFuseFilter/binary_fuse.h"
+#include "../RibbonFilter/ribbon.h"
+#include "../VectorQuotientFilter/vqf.h"
+#include "../hashing/hashing.h"
+
+#define DEFAULT_NDV 1000000
+#define DEFAULT_FPP 0.01
+
+//-----------------------------------------------------------------------------
+// classic
+
+static void* classicCreate(long int ndv, double fpp){
+    return createBloomFilter(ndv, fpp);
+}
+
+static void classicDestroy(void* impl){
+    BloomFilter* bf = (BloomFilter*)impl;
+    free(bf->bit_array);
+    free(bf);
+}
+
+static int classicInsert(void* impl, const void* str, size_t size){
+    Put((BloomFilter*)impl, str, size);
+    return 0;
+}
+
+static int classicContains(void* impl, const void* str, size_t size){
+    return !Check((BloomFilter*)impl, str, size);
+}
+
+static size_t classicInsertBatch(void* impl, const void* keys, size_t key_size, size_t n){
+    BloomFilterBuildFromKeys((BloomFilter*)impl, keys, key_size, n, 1);
+    return n;
+}
+
+static uint64_t classicSizeInBytes(void* impl){
+    return ((BloomFilter*)impl)->num_words * sizeof(uint64_t);
+}
+
+static double classicFpp(void* impl, uint64_t inserted){
+    BloomFilter* bf = (BloomFilter*)impl;
+    return pow(1 - exp(-(double)bf->hash_count * inserted / bf->size), bf->hash_count);
+}
+
+static const FilterOps classicOps = {
+    "classic", classicCreate, classicDestroy, classicInsert, classicContains,
+    classicInsertBatch, NULL, NULL, NULL, classicSizeInBytes, classicFpp,
+    NULL, NULL, NULL, NULL};
+
+//-----------------------------------------------------------------------------
+// sbbf
+
+static void* sbbfCreate(long int ndv, double fpp){
+    return createSplitBlockBloomFilter(ndv, fpp);
+}
+
+static void sbbfDestroy(void* impl){
+    DestroySplitBlockBloomFilter((SplitBlockBloomFilter*)impl);
+}
+
+static int sbbfInsert(void* impl, const void* str, size_t size){
+    SplitBlockBloomFilter* bf = (SplitBlockBloomFilter*)impl;
+    bf->Insert(bf, str, size);
+    return 0;
+}
+
+static int sbbfContains(void* impl, const void* str, size_t size){
+    return !CheckKey((SplitBlockBloomFilter*)impl, str, size);
+}
+
+static size_t sbbfInsertBatch(void* impl, const void* keys, size_t key_size, size_t n){
+    SplitBlockBloomFilter* bf = (SplitBlockBloomFilter*)impl;
+    bf->InsertBatch(bf, keys, key_size, n);
+    return n;
+}
+
+static void sbbfContainsBatch(void* impl, const void* keys, size_t key_size, size_t n, uint64_t* result){
+    CheckKeyBatch((SplitBlockBloomFilter*)impl, keys, key_size, n, result);
+}
+
+static int sbbfSave(void* impl, const char* path){
+    return SaveSplitBlockBloomFilter((SplitBlockBloomFilter*)impl, path);
+}
+
+static uint64_t sbbfSizeInBytes(void* impl){
+    return ((SplitBlockBloomFilter*)impl)->size / 8;
+}
+
+static double sbbfFpp(void* impl, uint64_t inserted){
+    return libfilter_block_fpp(inserted, sbbfSizeInBytes(impl));
+}
+
+static int sbbfInsertU64(void* impl, uint64_t key){
+    InsertU64((SplitBlockBloomFilter*)impl, key);
+    return 0;
+}
+
+static int sbbfContainsU64(void* impl, uint64_t key){
+    return !CheckKeyU64((SplitBlockBloomFilter*)impl, key);
+}
+
+static size_t sbbfInsertU64Batch(void* impl, const uint64_t* keys, size_t n){
+    InsertU64Batch((SplitBlockBloomFilter*)impl, keys, n);
+    return n;
+}
+
+static void sbbfContainsU64Batch(void* impl, const uint64_t* keys, size_t n, uint64_t* result){
+    CheckKeyU64Batch((SplitBlockBloomFilter*)impl, keys, n, result);
+}
+
+static const FilterOps sbbfOps = {
+    "sbbf", sbbfCreate, sbbfDestroy, sbbfInsert, sbbfContains,
+    sbbfInsertBatch, sbbfContainsBatch, NULL, sbbfSave, sbbfSizeInBytes, sbbfFpp,
+    sbbfInsertU64, sbbfContainsU64, sbbfInsertU64Batch, sbbfContainsU64Batch};
+
+//-----------------------------------------------------------------------------
+// blocked
+
+static void* blockedCreate(long int ndv, double fpp){
+    return createBlockedBloomFilter(ndv, fpp);
+}
+
+static void blockedDestroy(void* impl){
+    BlockedBloomFilter* bf = (BlockedBloomFilter*)impl;
+    free(bf->bit_array);
+    free(bf);
+}
+
+static int blockedInsert(void* impl, const void* str, size_t size){
+    BlockedPut((BlockedBloomFilter*)impl, str, size);
+    return 0;
+}
+
+static int blockedContains(void* impl, const void* str, size_t size){
+    return !BlockedCheck((BlockedBloomFilter*)impl, str, size);
+}
+
+static uint64_t blockedSizeInBytes(void* impl){
+    return ((BlockedBloomFilter*)impl)->size / 8;
+}
+
+static double blockedFpp(void* impl, uint64_t inserted){
+    BlockedBloomFilter* bf = (BlockedBloomFilter*)impl;
+    return BlockedBloomFpp(inserted, bf->num_blocks, bf->hash_count);
+}
+
+static const FilterOps blockedOps = {
+    "blocked", blockedCreate, blockedDestroy, blockedInsert, blockedContains,
+    NULL, NULL, NULL, NULL, blockedSizeInBytes, blockedFpp,
+    NULL, NULL, NULL, NULL};
+
+//-----------------------------------------------------------------------------
+// growable
+
+static void* growableCreate(long int ndv, double fpp){
+    return createGrowableBloomFilter(ndv, fpp);
+}
+
+static void growableDestroy(void* impl){
+    DestroyGrowableBloomFilter((GrowableBloomFilter*)impl);
+}
+
+static int growableInsert(void* impl, const void* str, size_t size){
+    GrowableInsert((GrowableBloomFilter*)impl, str, size);
+    return 0;
+}
+
+static int growableContains(void* impl, const void* str, size_t size){
+    return !GrowableCheckKey((GrowableBloomFilter*)impl, str, size);
+}
+
+static size_t growableInsertBatch(void* impl, const void* keys, size_t key_size, size_t n){
+    GrowableInsertBatch((GrowableBloomFilter*)impl, keys, key_size, n);
+    return n;
+}
+
+static void growableContainsBatch(void* impl, const void* keys, size_t key_size, size_t n, uint64_t* result){
+    GrowableCheckKeyBatch((GrowableBloomFilter*)impl, keys, key_size, n, result);
+}
+
+static uint64_t growableSizeInBytes(void* impl){
+    return GrowableSizeInBytes((GrowableBloomFilter*)impl);
+}
+
+// The filter keeps its own count, which also covers keys from before a reopen
+static double growableFpp(void* impl, uint64_t inserted){
+    (void)inserted;
+    return GrowableFpp((GrowableBloomFilter*)impl);
+}
+
+static int growableInsertU64(void* impl, uint64_t key){
+    GrowableInsertU64((GrowableBloomFilter*)impl, key);
+    return 0;
+}
+
+static int growableContainsU64(void* impl, uint64_t key){
+    return !GrowableCheckKeyU64((GrowableBloomFilter*)impl, key);
+}
+
+static size_t growableInsertU64Batch(void* impl, const uint64_t* keys, size_t n){
+    GrowableInsertU64Batch((GrowableBloomFilter*)impl, keys, n);
+    return n;
+}
+
+static void growableContainsU64Batch(void* impl, const uint64_t* keys, size_t n, uint64_t* result){
+    GrowableCheckKeyU64Batch((GrowableBloomFilter*)impl, keys, n, result);
+}
+
+static const FilterOps growableOps = {
+    "growable", growableCreate, growableDestroy, growableInsert, growableContains,
+    growableInsertBatch, growableContainsBatch, NULL, NULL, growableSizeInBytes, growableFpp,
+    growableInsertU64, growableContainsU64, growableInsertU64Batch, growableContainsU64Batch};
+
+//-----------------------------------------------------------------------------
+// counting
+
+static void* countingCreate(long int ndv, double fpp){
+    return createCountingBloomFilter(ndv, fpp);
+}
+
+static void countingDestroy(void* impl){
+    DestroyCountingBloomFilter((CountingBloomFilter*)impl);
+}
+
+static int countingInsert(void* impl, const void* str, size_t size){
+    CountingPut((CountingBloomFilter*)impl, str, size);
+    return 0;
+}
+
+static int countingContains(void* impl, const void* str, size_t size){
+    return !CountingCheck((CountingBloomFilter*)impl, str, size);
+}
+
+static size_t countingInsertBatch(void* impl, const void* keys, size_t key_size, size_t n){
+    CountingPutBatch((CountingBloomFilter*)impl, keys, key_size, n);
+    return n;
+}
+
+static void countingContainsBatch(void* impl, const void* keys, size_t key_size, size_t n, uint64_t* result){
+    CountingCheckBatch((CountingBloomFilter*)impl, keys, key_size, n, result);
+}
+
+static int countingDelete(void* impl, const void* str, size_t size){
+    return CountingDelete((CountingBloomFilter*)impl, str, size) ? -1 : 0;
+}
+
+static uint64_t countingSizeInBytes(void* impl){
+    return ((CountingBloomFilter*)impl)->size / 2;
+}
+
+static double countingFpp(void* impl, uint64_t inserted){
+    CountingBloomFilter* bf = (CountingBloomFilter*)impl;
+    return CountingBloomFpp(inserted, bf->num_blocks, bf->hash_count);
+}
+
+static const FilterOps countingOps = {
+    "counting", countingCreate, countingDestroy, countingInsert, countingContains,
+    countingInsertBatch, countingContainsBatch, countingDelete, NULL, countingSizeInBytes, countingFpp,
+    NULL, NULL, NULL, NULL};
+
+//-----------------------------------------------------------------------------
+// vqf
+
+static void* vqfCreate(long int ndv, double fpp){
+    (void)fpp;
+    return createVectorQuotientFilter(ndv);
+}
+
+static void vqfDestroy(void* impl){
+    DestroyVectorQuotientFilter((VectorQuotientFilter*)impl);
+}
+
+static int vqfInsert(void* impl, const void* str, size_t size){
+    return VqfPut((VectorQuotientFilter*)impl, str, size);
+}
+
+static int vqfContains(void* impl, const void* str, size_t size){
+    return !VqfCheck((VectorQuotientFilter*)impl, str, size);
+}
+
+static size_t vqfInsertBatch(void* impl, const void* keys, size_t key_size, size_t n){
+    return VqfPutBatch((VectorQuotientFilter*)impl, keys, key_size, n);
+}
+
+static void vqfContainsBatch(void* impl, const void* keys, size_t key_size, size_t n, uint64_t* result){
+    VqfCheckBatch((VectorQuotientFilter*)impl, keys, key_size, n, result);
+}
+
+static int vqfDelete(void* impl, const void* str, size_t size){
+    return VqfDelete((VectorQuotientFilter*)impl, str, size) ? -1 : 0;
+}
+
+static int vqfSave(void* impl, const char* path){
+    return SaveVectorQuotientFilter((VectorQuotientFilter*)impl, path);
+}
+
+static uint64_t vqfSizeInBytes(void* impl){
+    return VqfSizeInBytes((VectorQuotientFilter*)impl);
+}
+
+// From the entries themselves, which also covers keys from before a reopen
+static double vqfFpp(void* impl, uint64_t inserted){
+    (void)inserted;
+    return VqfFpp((VectorQuotientFilter*)impl);
+}
+
+static const FilterOps vqfOps = {
+    "vqf", vqfCreate, vqfDestroy, vqfInsert, vqfContains,
+    vqfInsertBatch, vqfContainsBatch, vqfDelete, vqfSave, vqfSizeInBytes, vqfFpp,
+    NULL, NULL, NULL, NULL};
+
+//-----------------------------------------------------------------------------
+// Backends built once from every key: inserts collect hashes, and the first
+// lookup, save or stats call builds the filter, after which it is read-only.
+// When the build fails the hashes are kept for the next call to try again, and
+// lookups answer that every key may be present, so nothing is lost.
+
+typedef struct {
+    uint64_t* hashes;          // NULL once the filter is built
+    size_t count;
+    size_t capacity;
+} HashList;
+
+static int initHashList(HashList* list, long int ndv){
+    list->capacity = ndv;
+    list->count = 0;
+    list->hashes = (uint64_t*)malloc(list->capacity * sizeof(uint64_t));
+    if(list->hashes == NULL){
+        printf("Memory Not allocated!\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Returns 0 on success and -1 once the filter is built or out of memory
+static int appendHash(HashList* list, const char* backend, uint64_t hash){
+    if(list->hashes == NULL){
+        printf("The %s backend is read-only once built!\n", backend);
+        return -1;
+    }
+    if(list->count == list->capacity){
+        uint64_t* bigger = (uint64_t*)realloc(list->hashes, 2 * list->capacity * sizeof(uint64_t));
+        if(bigger == NULL){
+            printf("Memory Not allocated!\n");
+            return -1;
+        }
+        list->hashes = bigger;
+        list->capacity *= 2;
+    }
+    list->hashes[list->count++] = hash;
+    return 0;
+}
+
+static void freeHashList(HashList* list){
+    free(list->hashes);
+    list->hashes = NULL;
+}
+
+// The lookup result of a filter that could not be built
+static void allMayBePresent(size_t n, uint64_t* result){
+    memset(result, 0xff, n / 64 * sizeof(uint64_t));
+    if(n % 64 != 0){
+        result[n / 64] = (1ULL << (n % 64)) - 1;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// static
+
+typedef struct {
+    HashList keys;
+    StaticFilter* sf;
+} StaticBuilder;
+
+static void* staticCreate(long int ndv, double fpp){
+    (void)fpp;
+    StaticBuilder* b = (StaticBuilder*)malloc(sizeof(StaticBuilder));
+    if(b == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    b->sf = NULL;
+    if(initHashList(&b->keys, ndv) != 0){
+        free(b);
+        return NULL;
+    }
+    return b;
+}
+
+static void staticDestroy(void* impl){
+    StaticBuilder* b = (StaticBuilder*)impl;
+    if(b->sf != NULL){
+        DestroyStaticFilter(b->sf);
+    }
+    freeHashList(&b->keys);
+    free(b);
+}
+
+static StaticFilter* staticFreeze(StaticBuilder* b){
+    if(b->sf == NULL){
+        b->sf = BuildStaticFilterFromHashes(b->keys.hashes, b->keys.count);
+        if(b->sf != NULL){
+            freeHashList(&b->keys);
+        }
+    }
+    return b->sf;
+}
+
+static int staticInsert(void* impl, const void* str, size_t size){
+    return appendHash(&((StaticBuilder*)impl)->keys, "static", HashKey64(str, size, STATIC_FILTER_SEED));
+}
+
+static int staticContains(void* impl, const void* str, size_t size){
+    StaticFilter* sf = staticFreeze((StaticBuilder*)impl);
+    return sf == NULL || !StaticCheckKey(sf, str, size);
+}
+
+static void staticContainsBatch(void* impl, const void* keys, size_t key_size, size_t n, uint64_t* result){
+    StaticFilter* sf = staticFreeze((StaticBuilder*)impl);
+    if(sf == NULL){
+        allMayBePresent(n, result);
+        return;
+    }
+    StaticCheckKeyBatch(sf, keys, key_size, n, result);
+}
+
+static int staticSave(void* impl, const char* path){
+    StaticFilter* sf = staticFreeze((StaticBuilder*)impl);
+    return sf == NULL ? -1 : SaveStaticFilter(sf, path);
+}
+
+static uint64_t staticSizeInBytes(void* impl){
+    StaticFilter* sf = staticFreeze((StaticBuilder*)impl);
+    return sf == NULL ? 0 : StaticSizeInBytes(sf);
+}
+
+static double staticFpp(void* impl, uint64_t inserted){
+    (void)impl;
+    (void)inserted;
+    return 1.0 / 256;
+}
+
+static const FilterOps staticOps = {
+    "static", staticCreate, staticDestroy, staticInsert, staticContains,
+    NULL, staticContainsBatch, NULL, staticSave, staticSizeInBytes, staticFpp,
+    NULL, NULL, NULL, NULL};
+
+//-----------------------------------------------------------------------------
+// fuse8, fuse16
+
+typedef struct {
+    HashList keys;
+    int fingerprint_bits;
+    BinaryFuseFilter* ff;
+} FuseBuilder;
+
+static void* fuseCreate(long int ndv, int fingerprint_bits){
+    FuseBuilder* b = (FuseBuilder*)malloc(sizeof(FuseBuilder));
+    if(b == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    b->fingerprint_bits = fingerprint_bits;
+    b->ff = NULL;
+    if(initHashList(&b->keys, ndv) != 0){
+        free(b);
+        return NULL;
+    }
+    return b;
+}
+
+static void* fuse8Create(long int ndv, double fpp){
+    (void)fpp;
+    return fuseCreate(ndv, 8);
+}
+
+static void* fuse16Create(long int ndv, double fpp){
+    (void)fpp;
+    return fuseCreate(ndv, 16);
+}
+
+static void fuseDestroy(void* impl){
+    FuseBuilder* b = (FuseBuilder*)impl;
+    if(b->ff != NULL){
+        DestroyBinaryFuseFilter(b->ff);
+    }
+    freeHashList(&b->keys);
+    free(b);
+}
+
+static BinaryFuseFilter* fuseFreeze(FuseBuilder* b){
+    if(b->ff == NULL){
+        b->ff = BuildBinaryFuseFilterFromHashes(b->keys.hashes, b->keys.count, b->fingerprint_bits, 1);
+        if(b->ff != NULL){
+            freeHashList(&b->keys);
+        }
+    }
+    return b->ff;
+}
+
+static int fuseInsert(void* impl, const void* str, size_t size){
+    return appendHash(&((FuseBuilder*)impl)->keys, "fuse", HashKey64(str, size, FUSE_FILTER_SEED));
+}
+
+static int fuseContains(void* impl, const void* str, size_t size){
+    BinaryFuseFilter* ff = fuseFreeze((FuseBuilder*)impl);
+    return ff == NULL || !FuseCheckKey(ff, str, size);
+}
+
+static void fuseContainsBatch(void* impl, const void* keys, size_t key_size, size_t n, uint64_t* result){
+    BinaryFuseFilter* ff = fuseFreeze((FuseBuilder*)impl);
+    if(ff == NULL){
+        allMayBePresent(n, result);
+        return;
+    }
+    FuseCheckKeyBatch(ff, keys, key_size, n, result);
+}
+
+static int fuseSave(void* impl, const char* path){
+    BinaryFuseFilter* ff = fuseFreeze((FuseBuilder*)impl);
+    return ff == NULL ? -1 : SaveBinaryFuseFilter(ff, path);
+}
+
+static uint64_t fuseSizeInBytes(void* impl){
+    BinaryFuseFilter* ff = fuseFreeze((FuseBuilder*)impl);
+    return ff == NULL ? 0 : FuseSizeInBytes(ff);
+}
+
+static double fuseFpp(void* impl, uint64_t inserted){
+    (void)inserted;
+    return ldexp(1.0, -((FuseBuilder*)impl)->fingerprint_bits);
+}
+
+static const FilterOps fuse8Ops = {
+    "fuse8", fuse8Create, fuseDestroy, fuseInsert, fuseContains,
+    NULL, fuseContainsBatch, NULL, fuseSave, fuseSizeInBytes, fuseFpp,
+    NULL, NULL, NULL, NULL};
+
+static const FilterOps fuse16Ops = {
+    "fuse16", fuse16Create, fuseDestroy, fuseInsert, fuseContains,
+    NULL, fuseContainsBatch, NULL, fuseSave, fuseSizeInBytes, fuseFpp,
+    NULL, NULL, NULL, NULL};
+
+//-----------------------------------------------------------------------------
+// ribbon: sized for the requested FPP at the number of keys collected
+
+typedef struct {
+    HashList keys;
+    double fpp;
+    RibbonFilter* rf;
+} RibbonBuilder;
+
+static void* ribbonCreate(long int ndv, double fpp){
+    RibbonBuilder* b = (RibbonBuilder*)malloc(sizeof(RibbonBuilder));
+    if(b == NULL){
+        printf("Memory Not allocated!\n");
+        return NULL;
+    }
+    b->fpp = fpp;
+    b->rf = NULL;
+    if(initHashList(&b->keys, ndv) != 0){
+        free(b);
+        return NULL;
+    }
+    return b;
+}
+
+static void ribbonDestroy(void* impl){
+    RibbonBuilder* b = (RibbonBuilder*)impl;
+    if(b->rf != NULL){
+        DestroyRibbonFilter(b->rf);
+    }
+    freeHashList(&b->keys);
+    free(b);
+}
+
+static RibbonFilter* ribbonFreeze(RibbonBuilder* b){
+    if(b->rf == NULL){
+        b->rf = BuildRibbonFilterFromHashes(b->keys.hashes, b->keys.count,
+                                            RibbonBitsPerKey(b->keys.count, b->fpp));
+        if(b->rf != NULL){
+            freeHashList(&b->keys);
+        }
+    }
+    return b->rf;
+}
+
+static int ribbonInsert(void* impl, const void* str, size_t size){
+    return appendHash(&((RibbonBuilder*)impl)->keys, "ribbon", HashKey64(str, size, RIBBON_FILTER_SEED));
+}
+
+static int ribbonContains(void* impl, const void* str, size_t size){
+    RibbonFilter* rf = ribbonFreeze((RibbonBuilder*)impl);
+    return rf == NULL || !RibbonCheckKey(rf, str, size);
+}
+
+static void ribbonContainsBatch(void* impl, const void* keys, size_t key_size, size_t n, uint64_t* result){
+    RibbonFilter* rf = ribbonFreeze((RibbonBuilder*)impl);
+    if(rf == NULL){
+        allMayBePresent(n, result);
+        return;
+    }
+    RibbonCheckKeyBatch(rf, keys, key_size, n, result);
+}
+
+static uint64_t ribbonSizeInBytes(void* impl){
+    RibbonFilter* rf = ribbonFreeze((RibbonBuilder*)impl);
+    return rf == NULL ? 0 : RibbonSizeInBytes(rf);
+}
+
+static double ribbonFpp(void* impl, uint64_t inserted){
+    (void)inserted;
+    RibbonFilter* rf = ribbonFreeze((RibbonBuilder*)impl);
+    return rf == NULL ? 1 : RibbonFpp(rf);
+}
+
+static const FilterOps ribbonOps = {
+    "ribbon", ribbonCreate, ribbonDestroy, ribbonInsert, ribbonContains,
+    NULL, ribbonContainsBatch, NULL, NULL, ribbonSizeInBytes, ribbonFpp,
+    NULL, NULL, NULL, NULL};
+
+//-----------------------------------------------------------------------------
+
+typedef struct Backend {
+    const char* name;
+    const FilterOps* ops;
+} Backend;
+
+static const Backend backends[] = {
+    {"classic", &classicOps},
+    {"sbbf", &sbbfOps},
+    {"blocked", &blockedOps},
+    {"growable", &growableOps},
+    {"counting", &countingOps},
+    {"static", &staticOps},
+    {"fuse8", &fuse8Ops},
+    {"fuse16", &fuse16Ops},
+    {"ribbon", &ribbonOps},
+    {"vqf", &vqfOps},
+};
+
+static const FilterOps* findBackend(const char* name, size_t length){
+    for(size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++){
+        if(strlen(backends[i].name) == length && strncmp(backends[i].name, name, length) == 0){
+            return backends[i].ops;
+        }
+    }
+    return NULL;
+}
+
+static Filter* wrap(const FilterOps* ops, void* impl, long int ndv, double fpp){
+    Filter* f = (Filter*)malloc(sizeof(Filter));
+    if(f == NULL){
+        printf("Memory Not allocated!\n");
+        ops->Destroy(impl);
+        return NULL;
+    }
+    f->ops = ops;
+    f->impl = impl;
+    f->ndv = ndv;
+    f->fpp = fpp;
+    f->inserted = 0;
+    return f;
+}
+
+Filter* createFilter(const char* spec){
+    size_t length = strcspn(spec, ":");
+    const FilterOps* ops = findBackend(spec, length);
+    if(ops == NULL){
+        printf("Unknown filter backend '%.*s'!\n", (int)length, spec);
+        return NULL;
+    }
+
+    long int ndv = DEFAULT_NDV;
+    double fpp = DEFAULT_FPP;
+    const char* option = spec[length] == ':' ? spec + length + 1 : spec + length;
+    while(*option != '\0'){
+        char* end;
+        if(strncmp(option, "ndv=", 4) == 0){
+            ndv = strtol(option + 4, &end, 10);
+        }else if(strncmp(option, "fpp=", 4) == 0){
+            fpp = strtod(option + 4, &end);
+        }else{
+            end = (char*)option;
+        }
+        if(end == option || (*end != ',' && *end != '\0')){
+            printf("Bad filter spec '%s'!\n", spec);
+            return NULL;
+        }
+        option = *end == ',' ? end + 1 : end;
+    }
+    if(ndv <= 0 || !(fpp > 0 && fpp < 1)){
+        printf("Bad filter spec '%s'!\n", spec);
+        return NULL;
+    }
+
+    void* impl = ops->Create(ndv, fpp);
+    if(impl == NULL){
+        return NULL;
+    }
+    return wrap(ops, impl, ndv, fpp);
+}
+
+void DestroyFilter(Filter* f){
+    f->ops->Destroy(f->impl);
+    free(f);
+}
+
+int FilterInsert(Filter* f, const void* str, size_t size){
+    if(f->ops->Insert(f->impl, str, size) != 0){
+        return -1;
+    }
+    f->inserted++;
+    return 0;
+}
+
+int FilterContains(Filter* f, const void* str, size_t size){
+    return f->ops->Contains(f->impl, str, size);
+}
+
+size_t FilterInsertBatch(Filter* f, const void* keys, size_t key_size, size_t n){
+    size_t done = 0;
+    if(f->ops->InsertBatch != NULL){
+        done = f->ops->InsertBatch(f->impl, keys, key_size, n);
+    }else{
+        const char* key = (const char*)keys;
+        for(size_t i = 0; i < n; i++){
+            done += f->ops->Insert(f->impl, key + i * key_size, key_size) == 0;
+        }
+    }
+    f->inserted += done;
+    return done;
+}
+
+void FilterContainsBatch(Filter* f, const void* keys, size_t key_size, size_t n, uint64_t* result){
+    if(f->ops->ContainsBatch != NULL){
+        f->ops->ContainsBatch(f->impl, keys, key_size, n, result);
+        return;
+    }
+    const char* key = (const char*)keys;
+    memset(result, 0, (n + 63) / 64 * sizeof(uint64_t));
+    for(size_t i = 0; i < n; i++){
+        result[i / 64] |= (uint64_t)(f->ops->Contains(f->impl, key + i * key_size, key_size) != 0) << (i % 64);
+    }
+}
+
+int FilterInsertU64(Filter* f, uint64_t key){
+    int status;
+    if(f->ops->InsertU64 != NULL){
+        status = f->ops->InsertU64(f->impl, key);
+    }else{
+        status = f->ops->Insert(f->impl, &key, sizeof(key));
+    }
+    if(status != 0){
+        return -1;
+    }
+    f->inserted++;
+    return 0;
+}
+
+int FilterContainsU64(Filter* f, uint64_t key){
+    if(f->ops->ContainsU64 != NULL){
+        return f->ops->ContainsU64(f->impl, key);
+    }
+    return f->ops->Contains(f->impl, &key, sizeof(key));
+}
+
+size_t FilterInsertU64Batch(Filter* f, const uint64_t* keys, size_t n){
+    if(f->ops->InsertU64Batch == NULL){
+        return FilterInsertBatch(f, keys, sizeof(uint64_t), n);
+    }
+    size_t done = f->ops->InsertU64Batch(f->impl, keys, n);
+    f->inserted += done;
+    return done;
+}
+
+void FilterContainsU64Batch(Filter* f, const uint64_t* keys, size_t n, uint64_t* result){
+    if(f->ops->ContainsU64Batch != NULL){
+        f->ops->ContainsU64Batch(f->impl, keys, n, result);
+    }else{
+        FilterContainsBatch(f, keys, sizeof(uint64_t), n, result);
+    }
+}
+
+int FilterDelete(Filter* f, const void* str, size_t size){
+    if(f->ops->Delete == NULL || f->ops->Delete(f->impl, str, size) != 0){
+        return -1;
+    }
+    if(f->inserted > 0){
+        f->inserted--;
+    }
+    return 0;
+}
+
+int FilterSave(Filter* f, const char* path){
+    if(f->ops->Save == NULL){
+        printf("The %s backend cannot be saved!\n", f->ops->name);
+        return -1;
+    }
+    return f->ops->Save(f->impl, path);
+}
+
+Filter* FilterOpen(const char* path){
+    char magic[4];
+    FILE* file = fopen(path, "rb");
+    if(file == NULL){
+        printf("Could not open %s!\n", path);
+        return NULL;
+    }
+    size_t got = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+    if(got == sizeof(magic) && memcmp(magic, SBBF_FILE_MAGIC, sizeof(magic)) == 0){
+        SplitBlockBloomFilter* bf = OpenSplitBlockBloomFilter(path, 0);
+        return bf == NULL ? NULL : wrap(&sbbfOps, bf, bf->ndv, bf->fpp);
+    }
+    if(got == sizeof(magic) && memcmp(magic, STATIC_FILE_MAGIC, sizeof(magic)) == 0){
+        StaticBuilder* b = (StaticBuilder*)calloc(1, sizeof(StaticBuilder));
+        if(b == NULL){
+            printf("Memory Not allocated!\n");
+            return NULL;
+        }
+        b->sf = OpenStaticFilter(path, 0);
+        if(b->sf == NULL){
+            free(b);
+            return NULL;
+        }
+        return wrap(&staticOps, b, b->sf->num_keys, 1.0 / 256);
+    }
+    if(got == sizeof(magic) && memcmp(magic, FUSE_FILE_MAGIC, sizeof(magic)) == 0){
+        FuseBuilder* b = (FuseBuilder*)calloc(1, sizeof(FuseBuilder));
+        if(b == NULL){
+            printf("Memory Not allocated!\n");
+            return NULL;
+        }
+        b->ff = OpenBinaryFuseFilter(path, 0);
+        if(b->ff == NULL){
+            free(b);
+            return NULL;
+        }
+        b->fingerprint_bits = b->ff->fingerprint_bits;
+        return wrap(b->ff->fingerprint_bits == 8 ? &fuse8Ops : &fuse16Ops, b, b->ff->num_keys,
+                    ldexp(1.0, -b->ff->fingerprint_bits));
+    }
+    if(got == sizeof(magic) && memcmp(magic, VQF_FILE_MAGIC, sizeof(magic)) == 0){
+        VectorQuotientFilter* vqf = OpenVectorQuotientFilter(path, 0);
+        return vqf == NULL ? NULL : wrap(&vqfOps, vqf, (long int)vqf->occupancy,
+                                         ldexp(1.0, -(VQF_FINGERPRINT_BITS + VQF_TAIL_BITS)));
+    }
+    printf("%s is not a filter file!\n", path);
+    return NULL;
+}
+
+void FilterGetStats(Filter* f, FilterStats* stats){
+    stats->backend = f->ops->name;
+    stats->bytes = f->ops->SizeInBytes(f->impl);
+    stats->inserted = f->inserted;
+    stats->bits_per_key = 8.0 * stats->bytes / (f->inserted > 0 ? (double)f->inserted : (double)f->ndv);
+    stats->target_fpp = f->fpp;
+    stats->expected_fpp = f->ops->Fpp(f->impl, f->inserted);
+}
@@ -0,0 +1,121 @@
+#ifndef _FILTER_HANDLE_
+#define _FILTER_HANDLE_
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//-----------------------------------------------------------------------------
+
+// One handle over every filter in the library. The backend is chosen at runtime
+// from a spec string
+//
+//     name[:key=value[,key=value...]]
+//
+// e.g. "sbbf:ndv=1000000,fpp=0.001". Keys are ndv (default 1000000) and fpp
+// (default 0.01). Backend names:
+//
+//     classic   BloomFilter
+//     sbbf      SplitBlockBloomFilter
+//     blocked   BlockedBloomFilter
+//     growable  GrowableBloomFilter, ndv only sizes the first level
+//     counting  CountingBloomFilter, with FilterDelete
+//     vqf       VectorQuotientFilter, with FilterDelete. FPP is fixed at
+//               about 1/16384 and the filter doubles once ndv keys are in.
+//     static    StaticFilter, FPP fixed at 1/256. Inserts are collected and
+//               the filter is built by the first lookup, save or stats call;
+//               it is read-only after that. A build that fails is retried by
+//               the next such call, and until then every key may be present.
+//     fuse8     BinaryFuseFilter with 8-bit fingerprints (FPP 1/256) or
+//     fuse16    16-bit ones (FPP 1/65536), built like static
+//     ribbon    RibbonFilter, built like static and sized for fpp at the
+//               number of keys inserted; it has no file format
+//
+// Unlike the structs underneath, FilterContains returns 1 when the key may be
+// present and 0 when it is definitely absent.
+
+typedef struct FilterOps {
+    const char* name;
+    void* (*Create)(long int ndv, double fpp);
+    void (*Destroy)(void* impl);
+    // Returns 0 on success and -1 when the key could not be added
+    int (*Insert)(void* impl, const void* str, size_t size);
+    int (*Contains)(void* impl, const void* str, size_t size);
+    // Optional; the handle loops over single keys when missing. Returns the
+    // number of keys added.
+    size_t (*InsertBatch)(void* impl, const void* keys, size_t key_size, size_t n);
+    void (*ContainsBatch)(void* impl, const void* keys, size_t key_size, size_t n, uint64_t* result);
+    int (*Delete)(void* impl, const void* str, size_t size);
+    int (*Save)(void* impl, const char* path);
+    uint64_t (*SizeInBytes)(void* impl);
+    // Expected FPP once inserted keys have been added
+    double (*Fpp)(void* impl, uint64_t inserted);
+    // Optional 64-bit integer key paths; the handle passes the key's 8 bytes
+    // to the byte paths when missing
+    int (*InsertU64)(void* impl, uint64_t key);
+    int (*ContainsU64)(void* impl, uint64_t key);
+    size_t (*InsertU64Batch)(void* impl, const uint64_t* keys, size_t n);
+    void (*ContainsU64Batch)(void* impl, const uint64_t* keys, size_t n, uint64_t* result);
+} FilterOps;
+
+typedef struct Filter {
+    const FilterOps* ops;
+    void* impl;
+    long int ndv;               // Keys the filter was sized for
+    double fpp;                 // Target false positive probability
+    uint64_t inserted;          // Keys inserted, for the stats
+} Filter;
+
+typedef struct FilterStats {
+    const char* backend;
+    uint64_t bytes;
+    uint64_t inserted;
+    double bits_per_key;        // Over the inserted keys, or ndv before any insert
+    double target_fpp;
+    double expected_fpp;        // Model FPP at the current number of keys
+} FilterStats;
+
+// Returns NULL when the spec is malformed, names an unknown backend or the
+// filter cannot be allocated
+Filter* createFilter(const char* spec);
+void DestroyFilter(Filter* f);
+// Returns 0 on success and -1 when the key could not be added, e.g. to a
+// static, fuse or ribbon filter that is already built. Only added keys count
+// towards the stats.
+int FilterInsert(Filter* f, const void* str, size_t size);
+int FilterContains(Filter* f, const void* str, size_t size);
+// Batch forms over n fixed-size keys stored back to back in keys. Bit i of
+// result (n / 64 rounded up words) is set when key i may be present. The
+// insert returns the number of keys added.
+size_t FilterInsertBatch(Filter* f, const void* keys, size_t key_size, size_t n);
+void FilterContainsBatch(Filter* f, const void* keys, size_t key_size, size_t n, uint64_t* result);
+// 64-bit integer keys. sbbf and growable hash them with one multiply-xorshift
+// mixer instead of MurmurHash3; other backends take the key's 8 bytes in native
+// byte order. Either way a key inserted here must be looked up here too.
+int FilterInsertU64(Filter* f, uint64_t key);
+int FilterContainsU64(Filter* f, uint64_t key);
+size_t FilterInsertU64Batch(Filter* f, const uint64_t* keys, size_t n);
+void FilterContainsU64Batch(Filter* f, const uint64_t* keys, size_t n, uint64_t* result);
+// Returns 0 when the key was removed and -1 when the backend cannot delete or
+// knows the key is absent
+int FilterDelete(Filter* f, const void* str, size_t size);
+// Writes the filter to path in its backend's file format. Returns 0 on success
+// and -1 on error or when the backend has no file format.
+int FilterSave(Filter* f, const char* path);
+// Opens a file written by FilterSave, picking the backend from its header
+Filter* FilterOpen(const char* path);
+void FilterGetStats(Filter* f, FilterStats* stats);
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _FILTER_HANDLE_
@@ -0,0 +1,80 @@
+#include "hashing.h"
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+// The AVX2 path is compiled for AVX2 with target attributes and only taken when
+// the running CPU has it, so this file needs no ISA flags.
+#define AVX2 __attribute__((target("avx2")))
+
+// AVX2 has no 64-bit multiply, so build the low 64 bits of the product from
+// three 32x32->64 multiplies.
+AVX2 static inline __m256i mullo64(__m256i a, __m256i b){
+    __m256i lo = _mm256_mul_epu32(a, b);
+    __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                                     _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+    return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+}
+
+AVX2 static inline __m256i fmix64(__m256i k){
+    k = _mm256_xor_si256(k, _mm256_srli_epi64(k, 33));
+    k = mullo64(k, _mm256_set1_epi64x(0xff51afd7ed558ccdULL));
+    k = _mm256_xor_si256(k, _mm256_srli_epi64(k, 33));
+    k = mullo64(k, _mm256_set1_epi64x(0xc4ceb9fe1a85ec53ULL));
+    k = _mm256_xor_si256(k, _mm256_srli_epi64(k, 33));
+    return k;
+}
+
+// MurmurHash3_x64_128 of four keys of at most 8 bytes, zero-extended into the
+// lanes of k1, folded the same way as HashKey64. Keys this short never reach
+// the block loop, only the tail and the finalizer.
+AVX2 static inline __m256i murmur3Short(__m256i k1, uint32_t seed, size_t len){
+    __m256i h1 = _mm256_set1_epi64x(seed);
+    __m256i h2 = _mm256_set1_epi64x(seed ^ len);
+
+    k1 = mullo64(k1, _mm256_set1_epi64x(0x87c37b91114253d5ULL));
+    k1 = _mm256_or_si256(_mm256_slli_epi64(k1, 31), _mm256_srli_epi64(k1, 64 - 31));
+    k1 = mullo64(k1, _mm256_set1_epi64x(0x4cf5ad432745937fULL));
+    h1 = _mm256_xor_si256(h1, k1);
+    h1 = _mm256_xor_si256(h1, _mm256_set1_epi64x(len));
+
+    h1 = _mm256_add_epi64(h1, h2);
+    h2 = _mm256_add_epi64(h2, h1);
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+    h1 = _mm256_add_epi64(h1, h2);
+    h2 = _mm256_add_epi64(h2, h1);
+    return _mm256_xor_si256(h1, h2);
+}
+
+// Hashes the keys four at a time and returns how many were done
+AVX2 static size_t hashKeys64Avx2(const char* key, size_t key_size, size_t n, uint32_t seed, uint64_t* out){
+    size_t i = 0;
+    if(key_size == 8){
+        for(; i + 4 <= n; i += 4){
+            __m256i k1 = _mm256_loadu_si256((const __m256i*)(key + i * 8));
+            _mm256_storeu_si256((__m256i*)&out[i], murmur3Short(k1, seed, 8));
+        }
+    }else if(key_size == 4){
+        for(; i + 4 <= n; i += 4){
+            __m256i k1 = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i*)(key + i * 4)));
+            _mm256_storeu_si256((__m256i*)&out[i], murmur3Short(k1, seed, 4));
+        }
+    }
+    return i;
+}
+#endif
+
+void HashKeys64(const void* keys, size_t key_size, size_t n, uint32_t seed, uint64_t* out){
+    const char* key = (const char*)keys;
+    size_t i = 0;
+#if defined(__x86_64__)
+    if((key_size == 8 || key_size == 4) && __builtin_cpu_supports("avx2")){
+        i = hashKeys64Avx2(key, key_size, n, seed, out);
+    }
+#endif
+    for(; i < n; i++){
+        out[i] = HashKey64(key + i * key_size, key_size, seed);
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef _HASHING_H_
+#define _HASHING_H_
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "../murmur3/murmur3.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//-----------------------------------------------------------------------------
+
+// libfilter expects a full 64-bit pseudorandom hash: the bucket comes from the
+// high 32 bits and the in-bucket mask from the low 32 bits. The two halves of
+// MurmurHash3_x64_128 are folded together so both ends of the word are mixed.
+static inline uint64_t HashKey64(const void* key, size_t size, uint32_t seed){
+    uint64_t hash[2];
+    MurmurHash3_x64_128(key, (int)size, seed, hash);
+    return hash[0] ^ hash[1];
+}
+
+// Hashes n fixed-size keys laid out back to back in keys, writing HashKey64 of
+// key i to out[i]. 4- and 8-byte keys are hashed four at a time with AVX2 when
+// the running CPU has it.
+void HashKeys64(const void* keys, size_t key_size, size_t n, uint32_t seed, uint64_t* out);
+
+// Hash of a 64-bit integer key for the fixed-width fast paths: one
+// multiply-xorshift mixer (Pelle Evensen's moremur) with no length loop or tail
+// handling. It is a different function from HashKey64, so keys inserted through
+// a U64 call must be looked up through one too.
+static inline uint64_t HashU64(uint64_t key, uint32_t seed){
+    uint64_t x = key ^ (seed * 0x9e3779b97f4a7c15ULL);
+    x ^= x >> 27;
+    x *= 0x3c79ac492ba7b653ULL;
+    x ^= x >> 33;
+    x *= 0x1c69b3f74ac4ae35ULL;
+    x ^= x >> 27;
+    return x;
+}
+
+// Writes HashU64 of keys[i] to out[i]
+static inline void HashKeysU64(const uint64_t* keys, size_t n, uint32_t seed, uint64_t* out){
+    for(size_t i = 0; i < n; i++){
+        out[i] = HashU64(keys[i], seed);
+    }
+}
+
+#define CHECKSUM64_BASIS 0xcbf29ce484222325ULL
+
+// FNV-1a over 64-bit words in native byte order, then any trailing bytes; cheap enough
+// to run over multi-GB filter payloads. Pass CHECKSUM64_BASIS as hash to start,
+// or the previous result to continue a payload read in pieces whose lengths,
+// all but the last, are multiples of 8.
+static inline uint64_t Checksum64(uint64_t hash, const void* data, uint64_t bytes){
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t i = 0;
+    for(; i + sizeof(uint64_t) <= bytes; i += sizeof(uint64_t)){
+        uint64_t word;
+        memcpy(&word, p + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ULL;
+    }
+    for(; i < bytes; i++){
+        hash = (hash ^ p[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HASHING_H_
@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "parallel_build.h"
+
+// Keys per chunk. Large enough to amortize the barriers, small enough that the
+// entry buffers stay a few tens of MB.
+#define PARALLEL_BUILD_CHUNK (1 << 20)
+// Entries the sequential fallback expands into at a time, on the stack
+#define PARALLEL_BUILD_LOCAL 256
+
+//-----------------------------------------------------------------------------
+// Teams
+
+struct ParallelTeam {
+    pthread_barrier_t barrier;
+    // Workers wait here until every thread has been started, so the thread
+    // count they are given and the barrier is sized for is final
+    pthread_mutex_t gate;
+    pthread_cond_t opened;
+    int open;
+    int threads;
+    void (*Body)(void* ctx, ParallelTeam* team, int id, int threads);
+    void* ctx;
+};
+
+typedef struct {
+    ParallelTeam* team;
+    int id;
+} TeamMember;
+
+static void* teamWorker(void* arg){
+    TeamMember* member = (TeamMember*)arg;
+    ParallelTeam* team = member->team;
+    pthread_mutex_lock(&team->gate);
+    while(!team->open){
+        pthread_cond_wait(&team->opened, &team->gate);
+    }
+    pthread_mutex_unlock(&team->gate);
+    team->Body(team->ctx, team, member->id, team->threads);
+    return NULL;
+}
+
+int ParallelTeamRun(int threads, void (*Body)(void* ctx, ParallelTeam* team, int id, int threads), void* ctx){
+    if(threads < 1){
+        threads = 1;
+    }
+    ParallelTeam team;
+    team.Body = Body;
+    team.ctx = ctx;
+    team.open = 0;
+    TeamMember* members = (TeamMember*)malloc(threads * sizeof(TeamMember));
+    pthread_t* ids = (pthread_t*)malloc(threads * sizeof(pthread_t));
+    if(members == NULL || ids == NULL){
+        // Still get the work done, just on this thread
+        free(members);
+        free(ids);
+        members = NULL;
+        ids = NULL;
+        threads = 1;
+    }
+    pthread_mutex_init(&team.gate, NULL);
+    pthread_cond_init(&team.opened, NULL);
+    int started = 1;
+    for(; started < threads; started++){
+        members[started].team = &team;
+        members[started].id = started;
+        if(pthread_create(&ids[started], NULL, teamWorker, &members[started]) != 0){
+            break;
+        }
+    }
+    team.threads = started;
+    pthread_barrier_init(&team.barrier, NULL, started);
+    pthread_mutex_lock(&team.gate);
+    team.open = 1;
+    pthread_cond_broadcast(&team.opened);
+    pthread_mutex_unlock(&team.gate);
+    Body(ctx, &team, 0, started);
+    for(int t = 1; t < started; t++){
+        pthread_join(ids[t], NULL);
+    }
+    pthread_barrier_destroy(&team.barrier);
+    pthread_cond_destroy(&team.opened);
+    pthread_mutex_destroy(&team.gate);
+    free(members);
+    free(ids);
+    return started;
+}
+
+void ParallelTeamWait(ParallelTeam* team){
+    pthread_barrier_wait(&team->barrier);
+}
+
+//-----------------------------------------------------------------------------
+// Bulk build
+
+typedef struct {
+    const ParallelBuildOps* ops;
+    void* ctx;
+    const char* keys;
+    size_t key_size;
+    size_t n;
+    uint64_t* entries;       // Expanded entries, one slice per thread
+    uint64_t* partitioned;   // Entries grouped by partition
+    size_t* counts;          // counts[t * threads + p]: entries of thread t in partition p
+    size_t* offsets;         // Where thread t scatters its next entry of partition p
+    size_t* part_start;      // First entry of each partition, threads + 1 of them
+} BuildState;
+
+static inline int partitionOf(const BuildState* s, int threads, uint64_t entry){
+    uint64_t unit = s->ops->Unit(s->ctx, entry);
+    return (int)(((unsigned __int128)unit * threads) / s->ops->num_units);
+}
+
+static void buildWorker(void* ctx, ParallelTeam* team, int t, int threads){
+    BuildState* s = (BuildState*)ctx;
+    size_t* counts = &s->counts[t * threads];
+    size_t* offsets = &s->offsets[t * threads];
+
+    for(size_t chunk = 0; chunk < s->n; chunk += PARALLEL_BUILD_CHUNK){
+        size_t chunk_n = (s->n - chunk < PARALLEL_BUILD_CHUNK) ? s->n - chunk : PARALLEL_BUILD_CHUNK;
+        size_t lo = chunk_n * t / threads;
+        size_t hi = chunk_n * (t + 1) / threads;
+        uint64_t* mine = s->entries + lo * s->ops->max_entries;
+
+        // Expand this thread's slice and count its entries per partition
+        size_t produced = s->ops->Expand(s->ctx, s->keys + (chunk + lo) * s->key_size,
+                                         s->key_size, hi - lo, mine);
+        memset(counts, 0, threads * sizeof(size_t));
+        for(size_t i = 0; i < produced; i++){
+            counts[partitionOf(s, threads, mine[i])]++;
+        }
+        ParallelTeamWait(team);
+
+        // Prefix sums: partition p holds the entries of thread 0, then thread 1, ...
+        if(t == 0){
+            size_t pos = 0;
+            for(int p = 0; p < threads; p++){
+                s->part_start[p] = pos;
+                for(int u = 0; u < threads; u++){
+                    s->offsets[u * threads + p] = pos;
+                    pos += s->counts[u * threads + p];
+                }
+            }
+            s->part_start[threads] = pos;
+        }
+        ParallelTeamWait(team);
+
+        for(size_t i = 0; i < produced; i++){
+            s->partitioned[offsets[partitionOf(s, threads, mine[i])]++] = mine[i];
+        }
+        ParallelTeamWait(team);
+
+        s->ops->Apply(s->ctx, s->partitioned + s->part_start[t],
+                      s->part_start[t + 1] - s->part_start[t]);
+        ParallelTeamWait(team);
+    }
+}
+
+// Used when the build buffers cannot be allocated: expands and applies a few
+// keys at a time on the calling thread, which owns every unit
+static void buildSequentially(const ParallelBuildOps* ops, void* ctx, const char* keys,
+                              size_t key_size, size_t n){
+    uint64_t local[PARALLEL_BUILD_LOCAL];
+    uint64_t* entries = local;
+    size_t step = PARALLEL_BUILD_LOCAL / ops->max_entries;
+    if(step == 0){
+        entries = (uint64_t*)malloc(ops->max_entries * sizeof(uint64_t));
+        if(entries == NULL){
+            printf("Memory Not allocated!\n");
+            return;
+        }
+        step = 1;
+    }
+    for(size_t i = 0; i < n; i += step){
+        size_t count = n - i < step ? n - i : step;
+        size_t produced = ops->Expand(ctx, keys + i * key_size, key_size, count, entries);
+        ops->Apply(ctx, entries, produced);
+    }
+    if(entries != local){
+        free(entries);
+    }
+}
+
+void ParallelBuild(const ParallelBuildOps* ops, void* ctx, const void* keys,
+                   size_t key_size, size_t n, int threads){
+    if(n == 0){
+        return;
+    }
+    if(threads < 1){
+        threads = 1;
+    }
+    if((uint64_t)threads > ops->num_units){
+        threads = (int)ops->num_units;
+    }
+    size_t chunk = (n < PARALLEL_BUILD_CHUNK) ? n : PARALLEL_BUILD_CHUNK;
+
+    BuildState s;
+    s.ops = ops;
+    s.ctx = ctx;
+    s.keys = (const char*)keys;
+    s.key_size = key_size;
+    s.n = n;
+    s.entries = (uint64_t*)malloc(chunk * ops->max_entries * sizeof(uint64_t));
+    s.partitioned = (uint64_t*)malloc(chunk * ops->max_entries * sizeof(uint64_t));
+    s.counts = (size_t*)malloc(threads * threads * sizeof(size_t));
+    s.offsets = (size_t*)malloc(threads * threads * sizeof(size_t));
+    s.part_start = (size_t*)malloc((threads + 1) * sizeof(size_t));
+    if(s.entries == NULL || s.partitioned == NULL || s.counts == NULL || s.offsets == NULL ||
+       s.part_start == NULL){
+        // Still insert every key, just on this thread
+        buildSequentially(ops, ctx, s.keys, key_size, n);
+    }else{
+        // The buffers are sized for threads, and the team may run fewer
+        ParallelTeamRun(threads, buildWorker, &s);
+    }
+    free(s.entries);
+    free(s.partitioned);
+    free(s.counts);
+    free(s.offsets);
+    free(s.part_start);
+}
+
+typedef struct {
+    void (*Body)(void* ctx, size_t begin, size_t end);
+    void* ctx;
+    size_t begin;
+    size_t end;
+} ForRange;
+
+static void* forWorker(void* arg){
+    ForRange* range = (ForRange*)arg;
+    range->Body(range->ctx, range->begin, range->end);
+    return NULL;
+}
+
+void ParallelFor(size_t n, int threads, void (*Body)(void* ctx, size_t begin, size_t end), void* ctx){
+    if(threads < 1){
+        threads = 1;
+    }
+    if((size_t)threads > n){
+        threads = n > 0 ? (int)n : 1;
+    }
+    ForRange* ranges = (ForRange*)malloc(threads * sizeof(ForRange));
+    pthread_t* ids = (pthread_t*)malloc(threads * sizeof(pthread_t));
+    if(ranges == NULL || ids == NULL){
+        // Still get the work done, just on this thread
+        free(ranges);
+        free(ids);
+        Body(ctx, 0, n);
+        return;
+    }
+    for(int t = 0; t < threads; t++){
+        ranges[t].Body = Body;
+        ranges[t].ctx = ctx;
+        ranges[t].begin = n * t / threads;
+        ranges[t].end = n * (t + 1) / threads;
+    }
+    int started = 1;
+    for(; started < threads; started++){
+        if(pthread_create(&ids[started], NULL, forWorker, &ranges[started]) != 0){
+            break;
+        }
+    }
+    forWorker(&ranges[0]);
+    // Ranges whose thread could not be started run here
+    for(int t = started; t < threads; t++){
+        forWorker(&ranges[t]);
+    }
+    for(int t = 1; t < started; t++){
+        pthread_join(ids[t], NULL);
+    }
+    free(ranges);
+    free(ids);
+}
@@ -0,0 +1,62 @@
+#ifndef _PARALLEL_BUILD_H_
+#define _PARALLEL_BUILD_H_
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//-----------------------------------------------------------------------------
+
+// Describes how a filter is bulk built. A key expands into one or more 64-bit
+// entries (a hash, a bit position, ...), each entry writes into exactly one
+// unit (a bucket, a word, ...) of the filter, and applying an entry only ORs
+// bits into its unit, so the order entries are applied in does not matter.
+typedef struct ParallelBuildOps {
+    // Writes the entries for n keys stored back to back to out and returns how
+    // many were written, at most n * max_entries
+    size_t (*Expand)(void* ctx, const void* keys, size_t key_size, size_t n, uint64_t* out);
+    // The unit entry writes to, in [0, num_units)
+    uint64_t (*Unit)(void* ctx, uint64_t entry);
+    // Applies n entries that all fall in the calling thread's range of units
+    void (*Apply)(void* ctx, const uint64_t* entries, size_t n);
+    uint64_t num_units;
+    size_t max_entries;  // Most entries a single key expands into
+} ParallelBuildOps;
+
+// Builds a filter from n fixed-size keys with the given number of threads.
+// Keys are processed a chunk at a time: each thread expands a slice of the
+// chunk, the entries are radix-partitioned by unit into one contiguous range
+// of units per thread, and each thread then applies its own partition. No two
+// threads write the same unit, so no atomics are needed and the result is
+// bit-identical to inserting the keys one by one. When the build buffers
+// cannot be allocated the keys are inserted on the calling thread instead.
+void ParallelBuild(const ParallelBuildOps* ops, void* ctx, const void* keys,
+                   size_t key_size, size_t n, int threads);
+
+// A group of threads that work through phases in step, as ParallelBuild does
+typedef struct ParallelTeam ParallelTeam;
+
+// Runs Body on up to threads threads, the calling thread as id 0, and returns
+// once all are done. When a thread cannot be started the team goes ahead with
+// the ones that were: Body is given the final thread count, and
+// ParallelTeamWait waits for that many. Returns the count.
+int ParallelTeamRun(int threads, void (*Body)(void* ctx, ParallelTeam* team, int id, int threads), void* ctx);
+// Returns once every thread of the team has called it
+void ParallelTeamWait(ParallelTeam* team);
+
+// Splits [0, n) into one contiguous range per thread and calls Body on each,
+// with the calling thread taking the first range. Returns once all are done.
+void ParallelFor(size_t n, int threads, void (*Body)(void* ctx, size_t begin, size_t end), void* ctx);
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _PARALLEL_BUILD_H_
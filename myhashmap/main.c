@@ -68,9 +68,55 @@ void testHashMap() {
     printf("HashMap destroyed.\n");
 }
 
+// Puts n keys, looks up n keys that were never put, then removes the keys
+// and looks them up, printing how many Get calls the Bloom filter guard turned
+// away before walking a probe chain.
+void testBloomGuard() {
+    int n = 1000;
+    int bucketSize = 2 * n;
+    HashMap* map = createHashMap(bucketSize);
+    int* keys = (int*)malloc(2 * n * sizeof(int));
+    if (map == NULL || keys == NULL) {
+        return;
+    }
+    if (EnableBloomGuard(map, 0.01) != 0) {
+        return;
+    }
+    for (int i = 0; i < 2 * n; i++) {
+        keys[i] = i * 7919;
+    }
+    for (int i = 0; i < n; i++) {
+        map->Put(map, &keys[i], &keys[i], sizeof(int));
+    }
+
+    int found = 0;
+    for (int i = 0; i < n; i++) {
+        found += (map->Get(map, &keys[i], sizeof(int)) != NULL);
+    }
+    for (int i = n; i < 2 * n; i++) {
+        found += (map->Get(map, &keys[i], sizeof(int)) != NULL);
+    }
+    printf("Found %d of %d put keys among %d lookups\n", found, n, 2 * n);
+    printf("Guard skipped: %lu, probed: %lu, false positives: %lu\n",
+           map->guardSkipped, map->guardProbed, map->guardFalsePositives);
+
+    for (int i = 0; i < n; i++) {
+        free(map->Remove(map, &keys[i], sizeof(int)));
+    }
+    int stale = 0;
+    for (int i = 0; i < n; i++) {
+        stale += (map->Get(map, &keys[i], sizeof(int)) != NULL);
+    }
+    printf("Removed keys still found: %d, guard rebuilds: %lu\n", stale, map->guardRebuilds);
+    map->DestroyHashMap(map);
+    free(keys);
+}
+
 int main() {
     printf("Starting HashMap tests...\n");
     testHashMap();
+    printf("\nTesting Bloom filter guard...\n");
+    testBloomGuard();
     printf("All tests completed.\n");
     return 0;
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <string.h>
 #include <math.h>
 #include "hashmap.h"
+#include "sbbf.h"
 #include <stddef.h>
 
 unsigned long secondaryHash(const void* key, size_t size) {
@@ -56,6 +57,40 @@ int handleCollision(HashMap* map, void* key, int size){
 
 
 
+// Builds a fresh guard from the keys in the buckets, dropping the bits of
+// removed keys. On allocation failure the guard is turned off, which only
+// costs Get its shortcut.
+static int rebuildGuard(HashMap* map){
+    SplitBlockBloomFilter* guard = createSplitBlockBloomFilter(map->bucketSize, map->guardFpp);
+    if(map->guard != NULL){
+        DestroySplitBlockBloomFilter(map->guard);
+    }
+    map->guard = guard;
+    map->guardRemoved = 0;
+    if(guard == NULL){
+        return -1;
+    }
+    for (int i = 0; i < map->bucketSize; i++) {
+        if (map->buckets[i] != NULL) {
+            guard->Insert(guard, map->buckets[i]->key, map->buckets[i]->keySize);
+        }
+    }
+    return 0;
+}
+
+int EnableBloomGuard(HashMap* map, double fpp){
+    map->guardFpp = fpp;
+    return rebuildGuard(map);
+}
+
+void DisableBloomGuard(HashMap* map){
+    if(map->guard != NULL){
+        DestroySplitBlockBloomFilter(map->guard);
+        map->guard = NULL;
+    }
+    map->guardRemoved = 0;
+}
+
 // Function to create a new HashMap with a user-defined size
 HashMap* createHashMap(int bucketSize) {
     HashMap* map = (HashMap*)malloc(sizeof(HashMap));
@@ -73,6 +108,14 @@ HashMap* createHashMap(int bucketSize) {
     }
     
     map->bucketSize = bucketSize;
+    map->size = 0;
+    map->guard = NULL;
+    map->guardFpp = 0;
+    map->guardRemoved = 0;
+    map->guardSkipped = 0;
+    map->guardProbed = 0;
+    map->guardFalsePositives = 0;
+    map->guardRebuilds = 0;
     map->Put = Put;  // Assign Put function
     map->Get = Get;  // Assign Get function
     map->Remove = Remove;
@@ -91,6 +134,7 @@ void DestroyHashMap(HashMap* map){
         }
     }
     free(map->buckets);
+    DisableBloomGuard(map);
     map->bucketSize = 0;
     free(map);
     return;
@@ -108,16 +152,35 @@ void Put(HashMap* map, void* key, void* valuePtr, size_t size) {
     }
     newNode->key = key;
     newNode->valuePtr = valuePtr;
+    newNode->keySize = size;
     int index = map->handleCollision(map, key, size);
     // printf("Index: %d\n", index);
     if(index != -1){
         map->buckets[index] = newNode;
         // printf("Stored Index: %d\n",index);
         map->size++;
+        if(map->guard != NULL){
+            map->guard->Insert(map->guard, key, size);
+        }
     }
 }
 
 void* Get(HashMap* map, void* key, size_t size){
+    if(map->guard != NULL){
+        if(map->guardRemoved >= map->bucketSize * HASHMAP_GUARD_REBUILD){
+            rebuildGuard(map);
+            map->guardRebuilds++;
+        }
+        // The guard hashes the key bytes, so a key put under another pointer
+        // with the same bytes passes it and is settled by the probe
+        if(map->guard != NULL){
+            if(map->guard->CheckKey(map->guard, key, size)){
+                map->guardSkipped++;
+                return NULL;
+            }
+            map->guardProbed++;
+        }
+    }
     unsigned long hash = map->hashPointer(key, size);  // Get initial index
     int i = 0;
     int index = map->handleCollision(map, key, size);
@@ -125,9 +188,15 @@ void* Get(HashMap* map, void* key, size_t size){
         if(map->buckets[index] != NULL){
             return map->buckets[index]->valuePtr;
         }else{
+            if(map->guard != NULL){
+                map->guardFalsePositives++;
+            }
             return NULL;
         }
     }else{
+        if(map->guard != NULL){
+            map->guardFalsePositives++;
+        }
         return NULL;
     }
 }
@@ -196,6 +265,9 @@ myHashMapNode* Remove(HashMap* map, void* key, size_t size){
         return NULL;
     }else{
         map->size--;
+        if(map->guard != NULL && removedKey != NULL){
+            map->guardRemoved++;
+        }
         return removedKey;
     }
 }
@@ -8,17 +8,32 @@ extern "C" {
 
 #define HASHMAP_SIZE 5
 #define A 0.6180339887
+// Keys removed, as a fraction of bucketSize, before the guard is rebuilt
+#define HASHMAP_GUARD_REBUILD 0.25
 #include <stddef.h>
 
+struct SplitBlockBloomFilter;
+
 typedef struct { 
     void* key;
     void* valuePtr;
+    size_t keySize;
 } myHashMapNode;
 
 typedef struct HashMap {
     int bucketSize;
     myHashMapNode** buckets;
     int size;
+    // Optional split block filter of the keys put, so Get can turn most misses
+    // away without walking a probe chain. Removed keys stay in it until it is
+    // rebuilt on the first Get after guardRemoved crosses HASHMAP_GUARD_REBUILD.
+    struct SplitBlockBloomFilter* guard;  // NULL when the guard is off
+    double guardFpp;
+    int guardRemoved;                     // Keys removed since the guard was built
+    unsigned long guardSkipped;           // Get calls the guard answered without probing
+    unsigned long guardProbed;            // Get calls that went on to probe
+    unsigned long guardFalsePositives;    // Probed Get calls that found nothing
+    unsigned long guardRebuilds;
     void (*Put)(struct HashMap* map, void* key, void* valuePtr, size_t size);  // Function pointer for Put
     void* (*Get)(struct HashMap* map, void* key, size_t size);  // Function pointer for Get
     myHashMapNode* (*Remove)(struct HashMap* map, void* key, size_t size);
@@ -50,6 +65,10 @@ int HasNext(HashMapIterator* iterator);
 myHashMapNode* Remove(HashMap* map, void* key, size_t size);
 HashMap* createHashMap(int bucketSize);
 void DestroyHashMap(HashMap* map);
+// Turns the guard on with a filter sized for bucketSize keys at false positive
+// probability fpp, adding the keys already in the map. Returns 0 on success.
+int EnableBloomGuard(HashMap* map, double fpp);
+void DisableBloomGuard(HashMap* map);
 
 #ifdef __cplusplus
 }